@@ -0,0 +1,2717 @@
+#ifndef BACKTAB_H
+#define BACKTAB_H
+
+#include <string>
+#include <string_view>
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <set>
+#include <map>
+#include <array>
+#include <tuple>
+#include <thread>
+#include <chrono>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <charconv>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include "result_sink.h"
+#include "csv_reader.h"
+#include "sample_file.h"
+#include "sample_summary.h"
+#include "bench_report.h"
+#include "room_links.h"
+#include "score_histogram.h"
+#include "room_state.h"
+#include "order_kernel.h"
+#include "room_worklist.h"
+#include "search_strategy.h"
+#include "work_pool.h"
+#include "sample_queue.h"
+
+// global variables
+std::mutex output_mutex {}; // Held while writing to cout
+
+
+class Room {
+public:
+    std::array<int, 4> teams {}; // Team ids, in draw order
+    CandidateOrders poss_orders {all_orders}; // Results it might have had
+    std::uint32_t domain {(1u << num_orders) - 1}; // Bit k for orders[k]
+
+    void set_domain(std::uint32_t mask) {
+        // Narrows it down to the orders in mask, kept in table order
+        domain = mask;
+        poss_orders = CandidateOrders {};
+        for (int k {0}; k < num_orders; k++) {
+            if ((mask >> k) & 1) poss_orders.add(orders[k]);
+        }
+    }
+};
+
+
+class Round {
+    /*
+    One round's draw, as read from rN_draw.csv. For a round whose
+    results are being guessed, later_rooms[w] links each of its rooms to
+    the rooms of round w (an index into Draw::rounds) that a change to
+    its results can reach, for every later w
+    */
+public:
+    int number {}; // As in the file name
+    std::vector<Room> rooms {};
+    std::vector<int> room_of_team {}; // -1 if they skip the round
+    std::vector<RoomLinks> later_rooms {};
+    RoomLinks earlier_rooms {}; // Back from each room, as numbered below
+    bool narrowed {false}; // poss_orders cut down by --estimates
+    int first_id {0}; // Its first room's number across the guessed rounds
+};
+
+
+class Draw {
+    /*
+    Teams and rooms as read in from the files. Team data is kept as
+    parallel arrays indexed by team id, which runs densely in name order
+    (the same order as the output columns), and rooms hold team ids.
+    rounds runs from the first round being guessed to the round after
+    the last one; every draw after the first depends on the guesses, and
+    the last is only there for that.
+    Read-only once initialise is done, and shared by every worker
+    */
+public:
+    std::vector<std::string> names {};
+    std::vector<int> known {}; // Points before the first guessed round
+    std::vector<Round> rounds {};
+    int num_scores {}; // One more than the highest possible score
+    std::vector<std::vector<int>> bands {}; // Guessed room ids, for --split
+    std::vector<std::vector<int>> colours {}; // Ditto, for --colour-threads
+
+    int num_teams() const { return (int)names.size(); }
+    int num_guessed() const { return (int)rounds.size() - 1; }
+    int num_guessed_rooms() const {
+        return rounds.back().first_id; // The last round counts them up
+    }
+
+    std::vector<int> guessed_numbers() const {
+        std::vector<int> numbers {};
+        for (int u {0}; u < num_guessed(); u++) {
+            numbers.push_back(rounds[u].number);
+        }
+        return numbers;
+    }
+};
+
+
+class Layer {
+    /*
+    A worker's view of one round of the Draw: every team's score going
+    into it, and for rounds whose draw depends on the guesses, each
+    room's scores and pullups and the round's histograms
+    */
+public:
+    std::vector<int> scores {}; // Indexed by team id
+    std::vector<RoomState> rooms {}; // Indexed by room
+    std::vector<int> upd {}; // Universal Pullup Dict
+    ScoreHistogram usd {}; // Universal Sandwich Dict
+    int pullup_loss {0}; // Sum over upd of excess above 3, kept up to date
+
+    void add_pullup(int score, int increment) {
+        // A +/-1 step only moves the excess if it's above 3 either side
+        if (increment > 0 && upd[score] >= 3) pullup_loss++;
+        if (increment < 0 && upd[score] > 3) pullup_loss--;
+        upd[score] += increment;
+    }
+};
+
+
+class ColourWorker {
+    /*
+    What one thread of a --colour-threads sweep needs of its own to
+    score and choose for rooms while the run's state is read-only
+    */
+public:
+    OrderKernel kernel {};
+    std::vector<std::array<int, 2>> windows {};
+    Rng rng {};
+    long long orders_scored {0};
+};
+
+
+class ColourMove {
+public:
+    std::array<int, 4> order {}; // What the room should have next
+    int left {-1}; // The candidate it moves off, or -1 if it stays put
+};
+
+
+class SearchState {
+    /*
+    Everything a single restart writes to, so that several workers can
+    search at once on top of the same Draw
+    */
+public:
+    std::vector<std::vector<int>> est {}; // [guessed round][team id]
+    std::vector<Layer> layers {}; // Indexed like Draw::rounds
+    OrderKernel kernel {};
+    RoomWorklist worklist {};
+    MoveChooser chooser {};
+    std::vector<std::array<int, 2>> windows {}; // Per layer, from the kernel
+    std::vector<std::array<int, 4>> moved_buckets {}; // Round, score, usd, upd
+    Rng rng {}; // Re-seeded at the start of every run
+    long long orders_scored {0}; // Candidate orders looked at, for --bench
+    std::vector<std::unique_ptr<SearchState>> band_states {}; // For --split
+    std::unique_ptr<WorkPool> pool {}; // For --colour-threads
+    std::vector<ColourWorker> colour_workers {};
+    std::vector<ColourMove> colour_moves {}; // One per room of a colour
+
+    SearchState(const Draw& draw) {
+        est.assign(draw.num_guessed(), std::vector<int>(draw.num_teams(), 0));
+        layers.resize(draw.rounds.size());
+        windows.resize(draw.rounds.size());
+        for (int w {0}; w < (int)layers.size(); w++) {
+            layers[w].scores = draw.known;
+            if (w == 0) continue; // Its draw doesn't hang on any guess
+            layers[w].rooms.resize(draw.rounds[w].rooms.size());
+            layers[w].upd.assign(draw.num_scores, 0);
+            layers[w].usd = ScoreHistogram {draw.num_scores};
+        }
+    }
+
+    void set_score(int u, int team, int score) {
+        // Moves the team's score going into every round after u with it
+        int change {score - est[u][team]};
+        est[u][team] = score;
+        for (int w {u + 1}; w < (int)layers.size(); w++) {
+            layers[w].scores[team] += change;
+        }
+    }
+};
+
+
+void set_order(
+    SearchState& st,
+    const Draw& draw,
+    int u,
+    int room_id,
+    std::array<int, 4> order
+) {
+    // Give the scores to the teams
+    const Room& room {draw.rounds[u].rooms[room_id]};
+    for (int i {0}; i < 4; i++) st.set_score(u, room.teams[i], order[i]);
+    // Fix up each later room's score list, and with it the pullups
+    for (int w {u + 1}; w < (int)draw.rounds.size(); w++) {
+        const Round& later {draw.rounds[w]};
+        Layer& layer {st.layers[w]};
+        for (int later_id : draw.rounds[u].later_rooms[w][room_id]) {
+            std::array<int, 4> scores {};
+            for (int i {0}; i < 4; i++) {
+                scores[i] = layer.scores[later.rooms[later_id].teams[i]];
+            }
+            layer.rooms[later_id].set_scores(scores);
+        }
+    }
+}
+
+
+void update_globs(
+    SearchState& st,
+    const Draw& draw,
+    int u,
+    int room_id,
+    bool subtract_mode=false
+) {
+    int increment {(subtract_mode) ? -1 : 1};
+    for (int w {u + 1}; w < (int)draw.rounds.size(); w++) {
+        Layer& layer {st.layers[w]};
+        // 1. Update pullup loss
+        for (int later_id : draw.rounds[u].later_rooms[w][room_id]) {
+            for (int curr_pullup : layer.rooms[later_id].pullup_list()) {
+                layer.add_pullup(curr_pullup, increment);
+            }
+        }
+        // 2. Update sandwich loss
+        for (int team : draw.rounds[u].rooms[room_id].teams) {
+            layer.usd.add(layer.scores[team], increment);
+        }
+    }
+}
+
+
+void set_order_update_glob(
+    SearchState& st,
+    const Draw& draw,
+    int u,
+    int room_id,
+    std::array<int, 4> order
+) {
+    // Subtract old contributions, update order, add new contributions
+    update_globs(st, draw, u, room_id, true);
+    set_order(st, draw, u, room_id, order);
+    update_globs(st, draw, u, room_id, false);
+}
+
+
+int get_room_sandwich_loss(const SearchState& st, int w, int room_id) {
+    /*
+    Returns sandwich loss for a room of round w
+    Which is the sum of entries in usd with indices strictly between
+    the min and max team scores in the room
+    Offset is to take away intra-room sandwiches
+    */
+    const Layer& layer {st.layers[w]};
+    const RoomState& room_state {layer.rooms[room_id]};
+    int min_val {room_state.min_score()};
+    int filling_loss {
+        layer.usd.sum_between(min_val, room_state.max_score())
+    };
+    int offset {0};
+    for (int pullup : room_state.pullup_list()) if (pullup > min_val) offset++;
+    return filling_loss - offset;
+}
+
+
+int get_pullup_loss_rescan(const std::vector<int>& upd) {
+    // What the running pullup loss for upd should be, from scratch
+    int pullup_loss {0};
+    for (int pullup : upd) if (pullup > 3) pullup_loss += pullup - 3;
+    return pullup_loss;
+}
+
+
+void check_pullup_losses([[maybe_unused]] const SearchState& st) {
+    // Build with -DCHECK_LOSSES to verify the running totals as we go
+#ifdef CHECK_LOSSES
+    for (int w {1}; w < (int)st.layers.size(); w++) {
+        assert(st.layers[w].pullup_loss
+            == get_pullup_loss_rescan(st.layers[w].upd));
+    }
+#endif
+}
+
+
+int get_room_loss(const SearchState& st, const Draw& draw, int u, int room_id) {
+    // Looks forward to the rooms of every later round
+    int loss {0};
+    for (int w {u + 1}; w < (int)draw.rounds.size(); w++) {
+        for (int later_id : draw.rounds[u].later_rooms[w][room_id]) {
+            loss += get_room_sandwich_loss(st, w, later_id);
+        }
+        loss += st.layers[w].pullup_loss;
+    }
+    check_pullup_losses(st);
+    return loss;
+}
+
+
+TeamIndex get_teams(std::string directory, Draw& draw) {
+    /* Fills in the team arrays of draw, and returns an index from team
+    name to team id */
+    MappedFile file {directory + "/standings.csv"};
+    CsvReader reader {file};
+    std::vector<std::pair<std::string_view, int>> standings;
+    reader.next_line(); // Skip header
+    while (reader.next_line()) {
+        if (reader.size() < 2) throw reader.error("expected team,points");
+        standings.emplace_back(reader[0], reader.parse_int(1));
+    }
+    // Ids go in name order, which is also the order of the output columns
+    std::sort(standings.begin(), standings.end());
+    for (auto const& [name, known] : standings) {
+        if (!draw.names.empty() && draw.names.back() == name) {
+            throw std::runtime_error(
+                file.name() + ": " + std::string(name) + " is listed twice"
+            );
+        }
+        draw.names.emplace_back(name);
+        draw.known.push_back(known);
+    }
+    return TeamIndex {draw.names};
+}
+
+
+Round get_round(
+    std::string directory, const TeamIndex& ids, int num_teams, int number
+) {
+    Round round {};
+    round.number = number;
+    round.room_of_team.assign(num_teams, -1);
+    MappedFile file {directory + "/r" + std::to_string(number) + "_draw.csv"};
+    CsvReader reader {file};
+    reader.next_line(); // Skip header
+    while (reader.next_line()) {
+        if (reader.size() < 4) throw reader.error("expected 4 teams");
+        Room new_room {};
+        // Collect ids of the teams in the new room
+        for (int i {0}; i < 4; i++) {
+            std::string name {reader[i]};
+            int team {ids.find(reader[i])};
+            if (team == -1) throw reader.error("unknown team " + name);
+            if (round.room_of_team[team] != -1) {
+                throw reader.error(name + " is already in a room");
+            }
+            new_room.teams[i] = team;
+            round.room_of_team[team] = round.rooms.size();
+        }
+        round.rooms.push_back(new_room);
+    }
+    return round;
+}
+
+
+void link_rounds(Draw& draw) {
+    /*
+    Links each room of a guessed round u to the rooms of every later
+    round w: those its own teams go to, and those reached by following
+    the teams of the rooms it links to in round w - 1 (so a room is
+    judged on the neighbourhood it sets the draw for)
+    */
+    int num_rounds {(int)draw.rounds.size()};
+    for (int u {num_rounds - 2}; u >= 0; u--) {
+        Round& round {draw.rounds[u]};
+        int num_rooms {(int)round.rooms.size()};
+        round.later_rooms.assign(num_rounds, RoomLinks {});
+        std::vector<std::set<int>> links(num_rooms);
+        for (int w {u + 1}; w < num_rounds; w++) {
+            const std::vector<int>& room_of {draw.rounds[w].room_of_team};
+            std::vector<std::set<int>> next(num_rooms);
+            for (int room_id {0}; room_id < num_rooms; room_id++) {
+                std::set<int>& room_links {next[room_id]};
+                for (int team : round.rooms[room_id].teams) {
+                    if (room_of[team] != -1) room_links.insert(room_of[team]);
+                }
+                if (w == u + 1) continue;
+                const RoomLinks& step {draw.rounds[w - 1].later_rooms[w]};
+                for (int mid_id : links[room_id]) {
+                    room_links.insert(step[mid_id].begin(), step[mid_id].end());
+                }
+            }
+            // Then freeze them, as they never change from here on
+            round.later_rooms[w] = RoomLinks {next};
+            links.swap(next);
+        }
+    }
+    // Number the guessed rooms in one run, and link back to them
+    for (int w {1}; w < num_rounds; w++) {
+        const Round& previous {draw.rounds[w - 1]};
+        draw.rounds[w].first_id = previous.first_id + previous.rooms.size();
+    }
+    for (int w {1}; w < num_rounds; w++) {
+        std::vector<std::set<int>> earlier(draw.rounds[w].rooms.size());
+        for (int u {0}; u < w; u++) {
+            const Round& round {draw.rounds[u]};
+            for (int room_id {0}; room_id < (int)round.rooms.size();
+                 room_id++) {
+                for (int later_id : round.later_rooms[w][room_id]) {
+                    earlier[later_id].insert(round.first_id + room_id);
+                }
+            }
+        }
+        draw.rounds[w].earlier_rooms = RoomLinks {earlier};
+    }
+}
+
+
+int estimate_column(
+    std::string_view cell, const TeamIndex& ids, const Draw& draw, int& u
+) {
+    /*
+    The team a column of sims is for, setting u to the guessed round it
+    covers, or -1 if it's for some other round. Plain team names are
+    taken to be the first guessed round; <team>_r<round> says which
+    */
+    int team {ids.find(cell)};
+    u = 0;
+    size_t suffix {cell.rfind("_r")};
+    if (team != -1 || suffix == std::string_view::npos) return team;
+    int number {0};
+    const char* last {cell.data() + cell.size()};
+    auto [end, ec] = std::from_chars(cell.data() + suffix + 2, last, number);
+    if (ec != std::errc {} || end != last) return -1;
+    u = number - draw.rounds[0].number;
+    if (u < 0 || u >= draw.num_guessed()) u = -1;
+    return ids.find(cell.substr(0, suffix));
+}
+
+
+void read_estimate_samples(
+    const std::string& fname,
+    const TeamIndex& ids,
+    const Draw& draw,
+    std::vector<std::vector<unsigned char>>& seen
+) {
+    // Ditto for a --binary sample file, which says which rounds it covers
+    SampleFile samples {fname};
+    const SampleHeader& header {samples.get_header()};
+    std::vector<int> column_teams {};
+    for (const std::string& name : header.names) {
+        column_teams.push_back(ids.find(name));
+        if (column_teams.back() == -1) {
+            throw std::runtime_error(fname + ": unknown team " + name);
+        }
+    }
+    int num_teams {header.num_teams()};
+    for (int i {0}; i < (int)header.rounds.size(); i++) {
+        int u {header.rounds[i] - draw.rounds[0].number};
+        if (u < 0 || u >= draw.num_guessed()) continue;
+        seen[u].assign(draw.num_teams(), 0);
+        for (int sim {0}; sim < samples.size(); sim++) {
+            std::string_view row {samples.row(sim)};
+            for (int col {0}; col < num_teams; col++) {
+                int est_score {unpack_result(row, i * num_teams + col)};
+                seen[u][column_teams[col]] |= 1 << est_score;
+            }
+        }
+    }
+}
+
+
+void narrow_to_seen(Room& room, const std::vector<unsigned char>& seen) {
+    // Keeps the orders giving every team a result in its bits of seen
+    std::uint32_t mask {0};
+    for (int k {0}; k < num_orders; k++) {
+        bool possible {true};
+        for (int i {0}; i < 4; i++) {
+            possible &= (seen[room.teams[i]] >> orders[k][i]) & 1;
+        }
+        mask |= (std::uint32_t)possible << k;
+    }
+    room.set_domain(mask);
+}
+
+
+void read_estimates(
+    const std::string& fname, const TeamIndex& ids, Draw& draw
+) {
+    /*
+    Narrows the guessed rounds down using the sims of an earlier backtab
+    of them, in its CSV or --binary output: each room covered keeps only
+    the orders that give every team a result it was seen with. The CSV
+    header is resolved to team ids once, then each cell is just a digit
+    to parse and a bit to set, straight off the mapped file
+    */
+    std::vector<std::vector<unsigned char>> seen(draw.num_guessed());
+    MappedFile file {fname};
+    if (SampleHeader::is_sample_file(file.text())) {
+        read_estimate_samples(fname, ids, draw, seen);
+    } else {
+        CsvReader reader {file};
+        if (!reader.next_line()) throw reader.error("no header");
+        std::vector<int> column_teams(reader.size(), -1); // 0 is sim_num
+        std::vector<int> column_rounds(reader.size(), -1);
+        for (int col {1}; col < reader.size(); col++) {
+            int u {};
+            column_teams[col] = estimate_column(reader[col], ids, draw, u);
+            if (column_teams[col] == -1) {
+                throw reader.error("unknown team " + std::string(reader[col]));
+            }
+            column_rounds[col] = u;
+            if (u != -1) seen[u].assign(draw.num_teams(), 0);
+        }
+        while (reader.next_line()) {
+            if (reader.size() != (int)column_teams.size()) {
+                throw reader.error("row doesn't match the header");
+            }
+            for (int col {1}; col < reader.size(); col++) {
+                if (column_rounds[col] == -1) continue;
+                int est_score {reader.parse_int(col)};
+                if (est_score < 0 || est_score > 3) {
+                    throw reader.error("result out of range");
+                }
+                seen[column_rounds[col]][column_teams[col]] |= 1 << est_score;
+            }
+        }
+    }
+    bool any {false};
+    for (int u {0}; u < draw.num_guessed(); u++) {
+        if (seen[u].empty()) continue; // Not in the file, so left open
+        any = true;
+        draw.rounds[u].narrowed = true;
+        for (Room& room : draw.rounds[u].rooms) narrow_to_seen(room, seen[u]);
+    }
+    if (!any) throw std::runtime_error(fname + ": covers no guessed round");
+}
+
+
+int low_result(const CandidateOrders& poss_orders, int seat) {
+    // The least seat gets from any of them
+    int lo {3};
+    for (int k {0}; k < poss_orders.size; k++) {
+        lo = std::min(lo, poss_orders[k][seat]);
+    }
+    return lo;
+}
+
+
+int high_result(const CandidateOrders& poss_orders, int seat) {
+    int hi {0};
+    for (int k {0}; k < poss_orders.size; k++) {
+        hi = std::max(hi, poss_orders[k][seat]);
+    }
+    return hi;
+}
+
+
+void score_ranges(
+    const Draw& draw,
+    std::vector<std::vector<int>>& low,
+    std::vector<std::vector<int>>& high
+) {
+    // [layer][team]: the lowest and highest scores the rooms' orders allow
+    int num_layers {(int)draw.rounds.size()};
+    low.assign(num_layers, draw.known);
+    high.assign(num_layers, draw.known);
+    for (int w {1}; w < num_layers; w++) {
+        low[w] = low[w - 1];
+        high[w] = high[w - 1];
+        for (const Room& room : draw.rounds[w - 1].rooms) {
+            const CandidateOrders& poss_orders {room.poss_orders};
+            for (int i {0}; i < 4 && poss_orders.size > 0; i++) {
+                low[w][room.teams[i]] += low_result(poss_orders, i);
+                high[w][room.teams[i]] += high_result(poss_orders, i);
+            }
+        }
+    }
+}
+
+
+int prune_domains(Draw& draw) {
+    /*
+    Arc consistency on the sandwiches. No later room can have a team
+    from outside it scored strictly between its lowest and highest, so
+    for each later room, every combination of orders for the guessed
+    rooms its teams' scores hang on is checked against the teams whose
+    scores are already certain, and orders no clean combination uses
+    are dropped from those rooms' domains. That only ever drops orders
+    no zero-loss result can have, so it suits --estimates, where most
+    rooms are down to an order or two. Later rooms hanging on too many
+    combinations are left alone, as is a cut that would leave a room
+    with nothing. Goes round until nothing changes, since every cut can
+    make more scores certain. Returns how many orders were dropped
+    */
+    const long long most_combinations {4096};
+    int num_layers {(int)draw.rounds.size()};
+    int dropped {0};
+    bool changed {true};
+    while (changed) {
+        changed = false;
+        std::vector<std::vector<int>> low {};
+        std::vector<std::vector<int>> high {};
+        score_ranges(draw, low, high);
+        for (int w {1}; w < num_layers; w++) {
+            // certain_below[s]: teams certain to have a score below s
+            std::vector<int> certain_below(draw.num_scores + 1, 0);
+            for (int team {0}; team < draw.num_teams(); team++) {
+                if (low[w][team] == high[w][team]) {
+                    certain_below[low[w][team] + 1]++;
+                }
+            }
+            for (int s {1}; s <= draw.num_scores; s++) {
+                certain_below[s] += certain_below[s - 1];
+            }
+            const Round& later {draw.rounds[w]};
+            for (const Room& later_room : later.rooms) {
+                // The guessed rooms its teams' scores hang on
+                std::vector<Room*> supports {};
+                std::array<std::vector<std::array<int, 2>>, 4> sources {};
+                for (int p {0}; p < 4; p++) {
+                    int team {later_room.teams[p]};
+                    for (int u {0}; u < w; u++) {
+                        int room_id {draw.rounds[u].room_of_team[team]};
+                        if (room_id == -1) continue;
+                        Room* room {&draw.rounds[u].rooms[room_id]};
+                        int j {(int)(std::find(
+                            supports.begin(), supports.end(), room
+                        ) - supports.begin())};
+                        if (j == (int)supports.size()) supports.push_back(room);
+                        int seat {(int)(std::find(
+                            room->teams.begin(), room->teams.end(), team
+                        ) - room->teams.begin())};
+                        sources[p].push_back({j, seat});
+                    }
+                }
+                long long combinations {1};
+                for (Room* room : supports) {
+                    combinations *= room->poss_orders.size;
+                    if (combinations > most_combinations) break;
+                }
+                if (combinations <= 1 || combinations > most_combinations) {
+                    continue;
+                }
+                std::vector<int> picks(supports.size(), 0);
+                std::vector<std::uint32_t> clean(supports.size(), 0);
+                auto clean_inside = [&](int lo, int hi) {
+                    // Whether no certain outsider is strictly in between
+                    if (hi - lo < 2) return true;
+                    int inside {certain_below[hi] - certain_below[lo + 1]};
+                    for (int team : later_room.teams) {
+                        int score {low[w][team]};
+                        inside -= score == high[w][team]
+                            && score > lo && score < hi;
+                    }
+                    return inside == 0;
+                };
+                for (long long c {0}; c < combinations; c++) {
+                    long long rest {c};
+                    for (int j {0}; j < (int)supports.size(); j++) {
+                        picks[j] = rest % supports[j]->poss_orders.size;
+                        rest /= supports[j]->poss_orders.size;
+                    }
+                    std::array<int, 4> scores {};
+                    for (int p {0}; p < 4; p++) {
+                        scores[p] = draw.known[later_room.teams[p]];
+                        for (const std::array<int, 2>& source : sources[p]) {
+                            const Room& room {*supports[source[0]]};
+                            scores[p] += room.poss_orders[picks[source[0]]][
+                                source[1]
+                            ];
+                        }
+                    }
+                    int min_score {*std::min_element(
+                        scores.begin(), scores.end()
+                    )};
+                    int max_score {*std::max_element(
+                        scores.begin(), scores.end()
+                    )};
+                    if (!clean_inside(min_score, max_score)) continue;
+                    for (int j {0}; j < (int)supports.size(); j++) {
+                        // The picks-th order left in the domain
+                        std::uint32_t mask {supports[j]->domain};
+                        for (int n {0}; n < picks[j]; n++) mask &= mask - 1;
+                        clean[j] |= mask & -mask;
+                    }
+                }
+                for (int j {0}; j < (int)supports.size(); j++) {
+                    Room& room {*supports[j]};
+                    if (clean[j] == room.domain || clean[j] == 0) continue;
+                    dropped += room.poss_orders.size;
+                    room.set_domain(clean[j]);
+                    dropped -= room.poss_orders.size;
+                    changed = true;
+                }
+            }
+        }
+    }
+    return dropped;
+}
+
+
+int find_component(std::vector<int>& parent, int id) {
+    // Union-find root, halving the path on the way up
+    while (parent[id] != id) id = parent[id] = parent[parent[id]];
+    return id;
+}
+
+
+void split_bands(Draw& draw, int parts) {
+    /*
+    Cuts the guessed rooms into parts score bands of about equal size,
+    for --split to sweep at once. Rooms sharing a later room are joined
+    into components, and a component small enough to fit in one band is
+    kept whole, with bands ending early rather than cutting one (which
+    the later bands make up for); the rest are cut by their rooms'
+    average known score, which power pairing keeps close together, so
+    the bands only meet where their scores do
+    */
+    int num_rooms {draw.num_guessed_rooms()};
+    std::vector<int> parent(num_rooms);
+    for (int id {0}; id < num_rooms; id++) parent[id] = id;
+    for (int w {1}; w < (int)draw.rounds.size(); w++) {
+        const Round& later {draw.rounds[w]};
+        for (int later_id {0}; later_id < (int)later.rooms.size();
+             later_id++) {
+            RoomLinks::Range earlier {later.earlier_rooms[later_id]};
+            for (int id : earlier) {
+                parent[find_component(parent, id)]
+                    = find_component(parent, *earlier.begin());
+            }
+        }
+    }
+    std::vector<double> room_score(num_rooms, 0);
+    std::vector<double> total(num_rooms, 0);
+    std::vector<int> size(num_rooms, 0);
+    for (int u {0}; u < draw.num_guessed(); u++) {
+        const Round& round {draw.rounds[u]};
+        for (int room_id {0}; room_id < (int)round.rooms.size(); room_id++) {
+            int id {round.first_id + room_id};
+            for (int team : round.rooms[room_id].teams) {
+                room_score[id] += draw.known[team] / 4.0;
+            }
+            int root {find_component(parent, id)};
+            total[root] += room_score[id];
+            size[root]++;
+        }
+    }
+    int band_size {(num_rooms + parts - 1) / parts};
+    std::vector<std::tuple<double, int, int>> keyed {}; // Key, group, id
+    for (int id {0}; id < num_rooms; id++) {
+        int root {find_component(parent, id)};
+        if (size[root] <= band_size) {
+            keyed.push_back({total[root] / size[root], root, id});
+        } else {
+            keyed.push_back({room_score[id], num_rooms + id, id}); // Alone
+        }
+    }
+    std::sort(keyed.begin(), keyed.end()); // Whole components stay in a row
+    draw.bands.assign(parts, std::vector<int> {});
+    int current_band {0};
+    int target {band_size};
+    for (int k {0}; k < num_rooms; k++) {
+        int group {std::get<1>(keyed[k])};
+        bool starts {k == 0 || group != std::get<1>(keyed[k - 1])};
+        int needs {(group < num_rooms) ? size[group] : 1};
+        int filled {(int)draw.bands[current_band].size()};
+        if (starts && current_band + 1 < parts && filled > 0
+            && filled + needs > target) {
+            current_band++;
+            int bands_left {parts - current_band};
+            target = (num_rooms - k + bands_left - 1) / bands_left;
+        }
+        draw.bands[current_band].push_back(std::get<2>(keyed[k]));
+    }
+    for (std::vector<int>& band : draw.bands) {
+        std::sort(band.begin(), band.end()); // Earlier rounds first
+    }
+}
+
+
+void colour_rooms(Draw& draw) {
+    /*
+    Colours the guessed rooms so that no two of a colour share a later
+    room, or have one in the other's later rooms; then nothing one of
+    them does moves a score or a room the other's scoring reads, and all
+    a colour's rooms can be scored against the same state at once.
+    Greedy, in room order, which power pairing keeps to a few colours
+    */
+    int num_rooms {draw.num_guessed_rooms()};
+    std::vector<std::set<int>> conflicts(num_rooms);
+    for (int w {1}; w < (int)draw.rounds.size(); w++) {
+        const Round& later {draw.rounds[w]};
+        bool guessed {w < draw.num_guessed()};
+        for (int later_id {0}; later_id < (int)later.rooms.size();
+             later_id++) {
+            RoomLinks::Range earlier {later.earlier_rooms[later_id]};
+            for (int id : earlier) {
+                for (int other : earlier) {
+                    if (other != id) conflicts[id].insert(other);
+                }
+                if (!guessed) continue;
+                conflicts[id].insert(later.first_id + later_id);
+                conflicts[later.first_id + later_id].insert(id);
+            }
+        }
+    }
+    std::vector<int> colour_of(num_rooms, -1);
+    draw.colours.clear();
+    for (int id {0}; id < num_rooms; id++) {
+        std::vector<bool> taken(draw.colours.size(), false);
+        for (int other : conflicts[id]) {
+            if (colour_of[other] != -1) taken[colour_of[other]] = true;
+        }
+        int colour {0};
+        while (colour < (int)taken.size() && taken[colour]) colour++;
+        if (colour == (int)draw.colours.size()) draw.colours.emplace_back();
+        colour_of[id] = colour;
+        draw.colours[colour].push_back(id);
+    }
+}
+
+
+void reset_results(SearchState& st, const Draw& draw) {
+    for (int u {0}; u < draw.num_guessed(); u++) {
+        const Round& round {draw.rounds[u]};
+        // Teams that miss the round get 0
+        for (int team {0}; team < draw.num_teams(); team++) {
+            if (round.room_of_team[team] == -1) st.set_score(u, team, 0);
+        }
+        // Assign a random result per room
+        for (int room_id {0}; room_id < (int)round.rooms.size(); room_id++) {
+            set_order(st, draw, u, room_id, orders[st.rng.below(24)]);
+        }
+    }
+
+    // Reset globals
+    for (int w {1}; w < (int)draw.rounds.size(); w++) {
+        Layer& layer {st.layers[w]};
+        std::fill(layer.upd.begin(), layer.upd.end(), 0);
+        layer.usd.clear();
+        for (const RoomState& room_state : layer.rooms) {
+            for (int pullup : room_state.pullup_list()) layer.upd[pullup] += 1;
+        }
+        layer.pullup_loss = get_pullup_loss_rescan(layer.upd);
+        for (int score : layer.scores) layer.usd.add(score, 1);
+    }
+}
+
+
+int get_global_pullup_loss(const SearchState& st) {
+    check_pullup_losses(st);
+    int pullup_loss {0};
+    for (const Layer& layer : st.layers) pullup_loss += layer.pullup_loss;
+    return pullup_loss;
+}
+
+
+int get_global_sandwich_loss(const SearchState& st, const Draw& draw) {
+    int sandwich_loss {0};
+    for (int w {1}; w < (int)draw.rounds.size(); w++) {
+        for (int room_id {0}; room_id < (int)draw.rounds[w].rooms.size();
+             room_id++) {
+            sandwich_loss += get_room_sandwich_loss(st, w, room_id);
+        }
+    }
+    return sandwich_loss;
+}
+
+
+int get_global_loss(const SearchState& st, const Draw& draw) {
+    return get_global_pullup_loss(st) + get_global_sandwich_loss(st, draw);
+}
+
+
+void score_orders(
+    const SearchState& st,
+    OrderKernel& kernel,
+    std::vector<std::array<int, 2>>& windows,
+    const Draw& draw,
+    int u,
+    int room_id,
+    const CandidateOrders& cands,
+    OrderLanes& losses
+) {
+    /*
+    Fills losses with what get_room_loss would give after
+    set_order_update_glob with each candidate order, all in one go and
+    without touching the scores, pullups or histograms. One kernel layer
+    per later round, each seeing the room's teams' scores going into it.
+    kernel and windows are the only things written, so threads with one
+    each can score rooms of the same state at once
+    */
+    const std::array<int, 4>& teams {draw.rounds[u].rooms[room_id].teams};
+    std::array<int, 4> old_scores {};
+    std::array<int, 4> base_scores {};
+    int pullup_loss {0};
+    for (int w {u + 1}; w < (int)draw.rounds.size(); w++) {
+        pullup_loss += st.layers[w].pullup_loss;
+    }
+    losses.fill(pullup_loss);
+    for (int w {u + 1}; w < (int)draw.rounds.size(); w++) {
+        const Round& later {draw.rounds[w]};
+        const Layer& layer {st.layers[w]};
+        for (int i {0}; i < 4; i++) {
+            old_scores[i] = layer.scores[teams[i]];
+            base_scores[i] = old_scores[i] - st.est[u][teams[i]];
+        }
+        kernel.start_layer(old_scores, base_scores, cands);
+        for (int later_id : draw.rounds[u].later_rooms[w][room_id]) {
+            kernel.add_room(
+                layer.rooms[later_id],
+                seats_in_room(later.rooms[later_id].teams, teams)
+            );
+        }
+        kernel.finish_layer(layer.usd, layer.upd, losses);
+        windows[w] = {kernel.low(), kernel.high()};
+    }
+}
+
+
+void score_orders(
+    SearchState& st,
+    const Draw& draw,
+    int u,
+    int room_id,
+    const CandidateOrders& cands,
+    OrderLanes& losses
+) {
+    // With the run's own kernel, keeping its windows for the worklist
+    score_orders(st, st.kernel, st.windows, draw, u, room_id, cands, losses);
+}
+
+
+int current_candidate(
+    const SearchState& st, const Draw& draw, int u, int room_id
+) {
+    // Which of the room's candidates it has now, or -1 if none
+    const Room& room {draw.rounds[u].rooms[room_id]};
+    for (int k {0}; k < room.poss_orders.size; k++) {
+        std::array<int, 4> order {room.poss_orders[k]};
+        bool same {true};
+        for (int i {0}; i < 4; i++) {
+            same &= st.est[u][room.teams[i]] == order[i];
+        }
+        if (same) return k;
+    }
+    return -1;
+}
+
+
+int guessed_round_of(const Draw& draw, int id) {
+    int u {0};
+    while (id >= draw.rounds[u + 1].first_id) u++;
+    return u;
+}
+
+
+void optimise_single_room(
+    SearchState& st, const Draw& draw, int u, int room_id
+) {
+    const CandidateOrders& poss_orders {
+        draw.rounds[u].rooms[room_id].poss_orders
+    };
+    if (poss_orders.size == 1) { // Nothing to choose between
+        set_order_update_glob(st, draw, u, room_id, poss_orders[0]);
+        return;
+    }
+    if (poss_orders.size == 0) { // No order fits what --estimates saw
+        set_order_update_glob(st, draw, u, room_id, {0, 0, 0, 0});
+        return;
+    }
+    int current {current_candidate(st, draw, u, room_id)};
+    OrderLanes losses {};
+    score_orders(st, draw, u, room_id, poss_orders, losses);
+    st.orders_scored += poss_orders.size;
+#ifdef CHECK_LOSSES
+    for (int k {0}; k < poss_orders.size; k++) {
+        set_order_update_glob(st, draw, u, room_id, poss_orders[k]);
+        assert(get_room_loss(st, draw, u, room_id) == losses[k]);
+    }
+#endif
+    int id {draw.rounds[u].first_id + room_id};
+    int choosable {};
+    int best {st.chooser.choose(
+        losses, poss_orders.size, id, current, st.rng, choosable
+    )};
+    set_order_update_glob(st, draw, u, room_id, poss_orders[best]); // Real move
+    if (best != current && current != -1) st.chooser.note_move(id, current);
+}
+
+
+void note_bucket(SearchState& st, int w, int score) {
+    // Keeps what the histograms of round w held at score before a move
+    const Layer& layer {st.layers[w]};
+    st.moved_buckets.push_back({w, score, layer.usd[score], layer.upd[score]});
+}
+
+
+void revisit_room(SearchState& st, const Draw& draw, int u, int room_id) {
+    /*
+    optimise_single_room for the worklist. If the room changes order, it
+    queues the rooms whose candidate losses that could change: those
+    sharing a later room with a team that moved, those a moved team is in
+    for later guessed rounds, and those watching a histogram bucket whose
+    count changed (swapping two teams' scores leaves the buckets alone).
+    Then the room watches the buckets its own scoring read. Rooms with
+    one possible order never need watching
+    */
+    const Room& room {draw.rounds[u].rooms[room_id]};
+    const CandidateOrders& poss_orders {room.poss_orders};
+    if (poss_orders.size <= 1) {
+        optimise_single_room(st, draw, u, room_id);
+        return;
+    }
+    std::array<int, 4> old_order {};
+    for (int i {0}; i < 4; i++) old_order[i] = st.est[u][room.teams[i]];
+    int current {current_candidate(st, draw, u, room_id)};
+    OrderLanes losses {};
+    score_orders(st, draw, u, room_id, poss_orders, losses);
+    st.orders_scored += poss_orders.size;
+#ifdef CHECK_LOSSES
+    for (int k {0}; k < poss_orders.size; k++) {
+        set_order_update_glob(st, draw, u, room_id, poss_orders[k]);
+        assert(get_room_loss(st, draw, u, room_id) == losses[k]);
+    }
+    set_order_update_glob(st, draw, u, room_id, old_order);
+#endif
+    int id {draw.rounds[u].first_id + room_id};
+    int choosable {};
+    int best {st.chooser.choose(
+        losses, poss_orders.size, id, current, st.rng, choosable
+    )};
+    std::array<int, 4> best_order {poss_orders[best]};
+    int num_rounds {(int)draw.rounds.size()};
+    if (best_order != old_order) {
+        if (current != -1) st.chooser.note_move(id, current);
+        st.moved_buckets.clear();
+        for (int w {u + 1}; w < num_rounds; w++) {
+            const Round& later {draw.rounds[w]};
+            for (int i {0}; i < 4; i++) {
+                int team {room.teams[i]};
+                int old_score {st.layers[w].scores[team]};
+                note_bucket(st, w, old_score);
+                if (best_order[i] == old_order[i]) continue;
+                note_bucket(st, w, old_score - old_order[i] + best_order[i]);
+                int later_id {later.room_of_team[team]};
+                if (later_id == -1) continue;
+                for (int other : later.earlier_rooms[later_id]) {
+                    if (other != id) st.worklist.push(other);
+                }
+                if (w < num_rounds - 1) {
+                    st.worklist.push(later.first_id + later_id);
+                }
+            }
+            // Pullups can come or go for anyone in the rooms it reaches
+            for (int later_id : draw.rounds[u].later_rooms[w][room_id]) {
+                for (int score : st.layers[w].rooms[later_id].scores) {
+                    note_bucket(st, w, score);
+                }
+            }
+        }
+        set_order_update_glob(st, draw, u, room_id, best_order);
+        for (const std::array<int, 4>& bucket : st.moved_buckets) {
+            const Layer& layer {st.layers[bucket[0]]};
+            if (layer.usd[bucket[1]] != bucket[2]
+                || layer.upd[bucket[1]] != bucket[3]) {
+                st.worklist.touch(bucket[0], bucket[1]);
+            }
+        }
+    }
+    // Keep wandering a plateau: a tie might go the other way next time
+    if (choosable > 1) {
+        st.worklist.push(id); // So no need to watch anything
+        return;
+    }
+    for (int w {u + 1}; w < num_rounds; w++) {
+        st.worklist.watch(w, st.windows[w][0], st.windows[w][1], id);
+    }
+}
+
+
+void print_predictions(const SearchState& st, const Draw& draw, int w) {
+    // The scores going into round w, room by room
+    for (const Room& room : draw.rounds[w].rooms) {
+        std::cout << "New r" << draw.rounds[w].number << " room\n";
+        for (int team : room.teams) {
+            std::cout << "\t" << st.layers[w].scores[team];
+            std::cout << "\t" << draw.names[team] << "\n";
+        }
+    }
+}
+
+
+std::string get_header(const Draw& draw) {
+    // Just the team names if there's one round, else <team>_r<round>
+    std::string header {"sim_num"};
+    std::vector<int> numbers {draw.guessed_numbers()};
+    for (const std::string& name : draw.names) {
+        if (numbers.size() == 1) {
+            header += "," + name;
+            continue;
+        }
+        for (int number : numbers) {
+            header += "," + name + "_r" + std::to_string(number);
+        }
+    }
+    return header;
+}
+
+
+SampleHeader get_sample_header(const Draw& draw, std::uint64_t seed) {
+    // Header for --binary output, see sample_file.h
+    SampleHeader header {};
+    header.names = draw.names;
+    header.rounds = draw.guessed_numbers();
+    header.seed = seed;
+    return header;
+}
+
+
+void export_prediction(const SearchState& st, ResultSink& sink) {
+    // Build the whole row first so it goes out in one write
+    std::string row {};
+    int num_teams {(int)st.layers[0].scores.size()};
+    if (sink.is_binary()) {
+        row.assign(sink.get_row_bytes(), 0);
+        for (int u {0}; u < (int)st.est.size(); u++) {
+            for (int team {0}; team < num_teams; team++) {
+                pack_result(row, u * num_teams + team, st.est[u][team]);
+            }
+        }
+        sink.write_row(row);
+        return;
+    }
+    for (int team {0}; team < num_teams; team++) {
+        for (const std::vector<int>& round_est : st.est) {
+            row += "," + std::to_string(round_est[team]);
+        }
+    }
+    sink.write_row(row);
+}
+
+
+class RunOptions {
+public:
+    int first_round {7}; // First and last rounds to guess (--guess K-M)
+    int last_round {7};
+    std::string estimates {}; // Earlier sims to narrow by (--estimates F)
+    int iterations {50}; // How many optimisation rounds it does
+    int narrowed_iterations {20}; // Ditto for rounds --estimates narrows
+    bool full_sweeps {false}; // Revisit every room every time (--full-sweeps)
+    StrategyOptions strategy {}; // How rooms choose, and kicks per run
+    int replicas {0}; // Parallel tempering with this many (--tempering K)
+    int swap_every {1}; // Sweeps between tempering swaps (--swap-every N)
+    int runs {1000}; // How many times it restarts from the top
+    int threshold {0}; // Highest loss that still counts as a success
+    int threads {1}; // How many restarts run at once (--threads N)
+    int split {1}; // Score bands each restart sweeps at once (--split N)
+    int colour_threads {1}; // Threads per sweep, by colour (--colour-threads)
+    bool exact {false}; // Branch and bound instead of searching (--exact)
+    bool stream {false}; // Sample the first round alongside (--stream)
+    int stream_threads {1}; // Threads sampling it (--stream-threads N)
+    long long exact_limit {1000000}; // Nodes per component (--exact-limit)
+    bool shared_file {false}; // Other processes append to it (--shared-file)
+    bool shards {false}; // One file per worker, merged at the end (--shards)
+    std::uint64_t seed {0}; // Run n is seeded from (seed, n) (--seed S)
+    int first_run {0}; // Skips ahead to replay a single run (--run N)
+    bool replay {false}; // Whether --run was given
+    bool binary {false}; // Packed 2-bit rows instead of CSV (--binary)
+    bool rows {true}; // Write out every sim (turned off by --no-rows)
+    std::string summary {}; // Where to keep running tallies (--summary F)
+    std::string pairs {}; // Teams to tally jointly (--pairs F)
+    int summary_every {100}; // Sims between summary writes
+    bool bench {false}; // Report speed and accuracy at the end (--bench)
+    std::string answers {}; // True results to check against, for --bench
+};
+
+
+bool sweep_descent(
+    SearchState& st,
+    const Draw& draw,
+    const std::vector<int>& iterations,
+    int& global_loss,
+    int threshold=0
+) {
+    /*
+    iterations says how many sweeps each guessed round gets; they go
+    round by round within a sweep, until the round's count runs out.
+    Returns whether the run got down to threshold
+    */
+    int sweeps {*std::max_element(iterations.begin(), iterations.end())};
+    for (int i {0}; i < sweeps; i++) {
+        st.chooser.set_progress((double)i / sweeps);
+        for (int u {0}; u < draw.num_guessed(); u++) {
+            if (i >= iterations[u]) continue;
+            for (int room_id {0}; room_id < (int)draw.rounds[u].rooms.size();
+                 room_id++) {
+                optimise_single_room(st, draw, u, room_id);
+            }
+        }
+        global_loss = get_global_loss(st, draw);
+        //std::cout << "Iter " << i + 1 << " loss: " << global_loss << "\n";
+        if (global_loss <= threshold) return true;
+    }
+    // print_predictions(st, draw, 1);
+    return false;
+}
+
+
+bool worklist_descent(
+    SearchState& st,
+    const Draw& draw,
+    const std::vector<int>& iterations,
+    int& global_loss,
+    int threshold=0
+) {
+    /*
+    sweep_descent, but only revisiting rooms on the worklist, so the
+    sweeps after most rooms have settled cost next to nothing. A round
+    gets as many room visits as its full sweeps would have had, the loss
+    is checked once per sweep's worth of visits, and the run stops early
+    once nothing is left to revisit
+    */
+    int num_rooms {draw.num_guessed_rooms()};
+    st.worklist.start(num_rooms, draw.rounds.size(), draw.num_scores);
+    std::vector<int> visits_left {};
+    long long budget {0};
+    for (int u {0}; u < draw.num_guessed(); u++) {
+        visits_left.push_back(iterations[u] * draw.rounds[u].rooms.size());
+        budget += visits_left.back();
+    }
+    long long visits {0};
+    int since_check {0};
+    while (!st.worklist.empty()) {
+        int id {st.worklist.pop()};
+        int u {guessed_round_of(draw, id)};
+        if (visits_left[u] == 0) continue;
+        visits_left[u]--;
+        st.chooser.set_progress((double)visits++ / budget);
+        revisit_room(st, draw, u, id - draw.rounds[u].first_id);
+        if (++since_check < num_rooms && !st.worklist.empty()) continue;
+        since_check = 0;
+        global_loss = get_global_loss(st, draw);
+        if (global_loss <= threshold) return true;
+    }
+    global_loss = get_global_loss(st, draw);
+    return global_loss <= threshold;
+}
+
+
+void sweep_band(
+    SearchState& st,
+    const Draw& draw,
+    const std::vector<int>& band,
+    const std::vector<int>& iterations,
+    int sweep
+) {
+    // One sweep over a band's rooms, for rounds that still have sweeps left
+    for (int id : band) {
+        int u {guessed_round_of(draw, id)};
+        if (sweep < iterations[u]) {
+            optimise_single_room(st, draw, u, id - draw.rounds[u].first_id);
+        }
+    }
+}
+
+
+bool split_descent(
+    SearchState& st,
+    const Draw& draw,
+    const std::vector<int>& iterations,
+    int& global_loss,
+    int threshold=0
+) {
+    /*
+    sweep_descent with each sweep cut into the --split score bands,
+    swept at once on threads of their own. Every band starts the sweep
+    from a copy of the run's state and only moves its own rooms, so it
+    sees the other bands as they were; then their moves are played back
+    into the run's state, which settles the histogram buckets the bands
+    share, and their choosers' tabu entries and visits go back into the
+    run's chooser for the next sweep. Each band is seeded off the run's
+    generator, so a run comes out the same however the threads are
+    scheduled
+    */
+    int parts {(int)draw.bands.size()};
+    while ((int)st.band_states.size() < parts) {
+        st.band_states.emplace_back(new SearchState {draw});
+    }
+    int sweeps {*std::max_element(iterations.begin(), iterations.end())};
+    for (int i {0}; i < sweeps; i++) {
+        long long start_visits {st.chooser.get_visits()};
+        std::vector<std::thread> workers;
+        for (int b {0}; b < parts; b++) {
+            SearchState& band_st {*st.band_states[b]};
+            band_st.est = st.est;
+            band_st.layers = st.layers;
+            band_st.chooser = st.chooser;
+            band_st.chooser.set_progress((double)i / sweeps);
+            band_st.rng.seed(st.rng(), b);
+            workers.emplace_back(
+                sweep_band, std::ref(band_st), std::cref(draw),
+                std::cref(draw.bands[b]), std::cref(iterations), i
+            );
+        }
+        for (std::thread& worker : workers) worker.join();
+        for (int b {0}; b < parts; b++) {
+            SearchState& band_st {*st.band_states[b]};
+            for (int id : draw.bands[b]) {
+                int u {guessed_round_of(draw, id)};
+                int room_id {id - draw.rounds[u].first_id};
+                std::array<int, 4> order {};
+                const std::array<int, 4>& teams {
+                    draw.rounds[u].rooms[room_id].teams
+                };
+                for (int j {0}; j < 4; j++) order[j] = band_st.est[u][teams[j]];
+                set_order_update_glob(st, draw, u, room_id, order);
+            }
+            st.chooser.absorb(band_st.chooser, start_visits, draw.bands[b]);
+            st.orders_scored += band_st.orders_scored;
+            band_st.orders_scored = 0;
+        }
+        global_loss = get_global_loss(st, draw);
+        if (global_loss <= threshold) return true;
+    }
+    return false;
+}
+
+
+void choose_colour_move(
+    const SearchState& st,
+    ColourWorker& worker,
+    const Draw& draw,
+    int id,
+    long long visit,
+    std::uint64_t seed,
+    ColourMove& move
+) {
+    /*
+    optimise_single_room for a colour sweep, leaving the move for later.
+    visit is the room's place in the run's visits, as if the colour's
+    rooms went one at a time, so tabu is the same for any thread count
+    */
+    int u {guessed_round_of(draw, id)};
+    int room_id {id - draw.rounds[u].first_id};
+    const CandidateOrders& poss_orders {
+        draw.rounds[u].rooms[room_id].poss_orders
+    };
+    move.left = -1;
+    if (poss_orders.size <= 1) {
+        move.order = (poss_orders.size == 1)
+            ? poss_orders[0] : std::array<int, 4> {0, 0, 0, 0};
+        return;
+    }
+    int current {current_candidate(st, draw, u, room_id)};
+    OrderLanes losses {};
+    score_orders(
+        st, worker.kernel, worker.windows, draw, u, room_id, poss_orders,
+        losses
+    );
+    worker.orders_scored += poss_orders.size;
+    worker.rng.seed(seed, id); // Whichever thread gets the room
+    int choosable {};
+    int best {st.chooser.choose_at(
+        losses, poss_orders.size, id, current, worker.rng, choosable, visit
+    )};
+    move.order = poss_orders[best];
+    if (best != current) move.left = current;
+}
+
+
+bool colour_descent(
+    SearchState& st,
+    const Draw& draw,
+    const std::vector<int>& iterations,
+    int& global_loss,
+    int threads,
+    int threshold=0
+) {
+    /*
+    sweep_descent a colour at a time, with each colour's rooms scored
+    and chosen on threads at once against the state as the colour found
+    it, and then all their moves made together. Rooms of a colour only
+    meet in the histograms, so this is the same as going one room at a
+    time except that each sees the others' histogram changes a colour
+    late. Rooms draw from generators seeded off the run's and their own
+    number, so a run comes out the same for any number of threads
+    */
+    if (!st.pool || st.pool->size() != threads) {
+        st.pool.reset(new WorkPool {threads});
+        st.colour_workers.assign(threads, ColourWorker {});
+        for (ColourWorker& worker : st.colour_workers) {
+            worker.windows.resize(draw.rounds.size());
+        }
+    }
+    int sweeps {*std::max_element(iterations.begin(), iterations.end())};
+    std::vector<int> ids {};
+    for (int i {0}; i < sweeps; i++) {
+        st.chooser.set_progress((double)i / sweeps);
+        for (const std::vector<int>& colour : draw.colours) {
+            ids.clear();
+            for (int id : colour) {
+                if (i < iterations[guessed_round_of(draw, id)]) {
+                    ids.push_back(id);
+                }
+            }
+            st.colour_moves.resize(ids.size());
+            std::uint64_t seed {st.rng()};
+            long long visits {st.chooser.get_visits()};
+            st.pool->run([&](int k) {
+                for (int j {k}; j < (int)ids.size(); j += threads) {
+                    choose_colour_move(
+                        st, st.colour_workers[k], draw, ids[j],
+                        visits + j + 1, seed, st.colour_moves[j]
+                    );
+                }
+            });
+            for (int j {0}; j < (int)ids.size(); j++) {
+                int u {guessed_round_of(draw, ids[j])};
+                const ColourMove& move {st.colour_moves[j]};
+                set_order_update_glob(
+                    st, draw, u, ids[j] - draw.rounds[u].first_id, move.order
+                );
+                if (move.left != -1) {
+                    st.chooser.note_move_at(ids[j], move.left, visits + j + 1);
+                }
+            }
+            st.chooser.advance(ids.size());
+        }
+        for (ColourWorker& worker : st.colour_workers) {
+            st.orders_scored += worker.orders_scored;
+            worker.orders_scored = 0;
+        }
+        global_loss = get_global_loss(st, draw);
+        if (global_loss <= threshold) return true;
+    }
+    return false;
+}
+
+
+void kick_rooms(SearchState& st, const Draw& draw, double share) {
+    /*
+    Shakes up a stuck run without starting again: every room that can
+    reach a later room with sandwich loss, or with a pullup at an
+    overfull score, gets a random possible order, and so does a random
+    share of the rest. Everything else keeps what it found
+    */
+    std::vector<bool> hot(draw.num_guessed_rooms(), false);
+    for (int w {1}; w < (int)draw.rounds.size(); w++) {
+        const Layer& layer {st.layers[w]};
+        for (int later_id {0}; later_id < (int)layer.rooms.size();
+             later_id++) {
+            bool lossy {get_room_sandwich_loss(st, w, later_id) > 0};
+            for (int pullup : layer.rooms[later_id].pullup_list()) {
+                lossy |= layer.upd[pullup] > 3;
+            }
+            if (!lossy) continue;
+            for (int id : draw.rounds[w].earlier_rooms[later_id]) {
+                hot[id] = true;
+            }
+        }
+    }
+    for (int u {0}; u < draw.num_guessed(); u++) {
+        const Round& round {draw.rounds[u]};
+        for (int room_id {0}; room_id < (int)round.rooms.size(); room_id++) {
+            const CandidateOrders& poss_orders {
+                round.rooms[room_id].poss_orders
+            };
+            if (poss_orders.size < 2) continue;
+            if (!hot[round.first_id + room_id] && st.rng.unit() >= share) {
+                continue;
+            }
+            set_order_update_glob(
+                st, draw, u, room_id,
+                poss_orders[st.rng.below(poss_orders.size)]
+            );
+        }
+    }
+}
+
+
+void warm_start(
+    SearchState& st, const Draw& draw, const std::vector<int>& results
+) {
+    // Gives the first guessed round the results of a sim of it alone
+    const Round& round {draw.rounds[0]};
+    for (int room_id {0}; room_id < (int)round.rooms.size(); room_id++) {
+        std::array<int, 4> order {};
+        for (int i {0}; i < 4; i++) {
+            order[i] = results[round.rooms[room_id].teams[i]];
+        }
+        set_order_update_glob(st, draw, 0, room_id, order);
+    }
+}
+
+
+bool single_full_run(
+    SearchState& st,
+    const Draw& draw,
+    const std::vector<int>& iterations,
+    int& global_loss,
+    const RunOptions& opts,
+    const std::vector<int>* first_round=nullptr
+) {
+    /*
+    One run from a random start, or with the first guessed round
+    starting from first_round's results if given: a descent, and if that
+    gets stuck above the threshold, up to --kicks more, each after
+    kick_rooms rather than throwing everything away.
+    Returns whether the run got down to threshold; the caller exports it
+    */
+    reset_results(st, draw);
+    if (first_round) warm_start(st, draw, *first_round);
+    st.chooser.start_run(opts.strategy, draw.num_guessed_rooms());
+    for (int kick {0}; ; kick++) {
+        bool success {};
+        if (opts.split > 1) {
+            success = split_descent(
+                st, draw, iterations, global_loss, opts.threshold
+            );
+        } else if (opts.colour_threads > 1) {
+            success = colour_descent(
+                st, draw, iterations, global_loss, opts.colour_threads,
+                opts.threshold
+            );
+        } else if (opts.full_sweeps) {
+            success = sweep_descent(
+                st, draw, iterations, global_loss, opts.threshold
+            );
+        } else {
+            success = worklist_descent(
+                st, draw, iterations, global_loss, opts.threshold
+            );
+        }
+        if (success || kick >= opts.strategy.kicks) return success;
+        kick_rooms(st, draw, opts.strategy.kick_share);
+    }
+}
+
+
+void initialise(std::string& dir, const RunOptions& opts, Draw& draw) {
+    // Get the relevant objects initialised
+    TeamIndex ids {get_teams(dir, draw)};
+    for (int number {opts.first_round}; number <= opts.last_round + 1;
+         number++) {
+        draw.rounds.push_back(get_round(dir, ids, draw.num_teams(), number));
+    }
+    link_rounds(draw);
+    int max_known {0};
+    for (int known : draw.known) max_known = std::max(max_known, known);
+    // Leave room for winning every guessed round
+    draw.num_scores = max_known + 3 * draw.num_guessed() + 1;
+    // Import earlier backtab output to save on effort
+    if (!opts.estimates.empty()) {
+        read_estimates(opts.estimates, ids, draw);
+        int dropped {prune_domains(draw)};
+        std::cout << "Orders ruled out by the draw: " << dropped << "\n";
+    }
+    if (opts.split > 1) split_bands(draw, opts.split);
+    if (opts.colour_threads > 1) colour_rooms(draw);
+}
+
+
+std::vector<int> round_iterations(const Draw& draw, const RunOptions& opts) {
+    std::vector<int> iterations {};
+    for (int u {0}; u < draw.num_guessed(); u++) {
+        iterations.push_back(
+            (draw.rounds[u].narrowed) ? opts.narrowed_iterations
+                                      : opts.iterations
+        );
+    }
+    return iterations;
+}
+
+
+class FirstRoundFeed {
+    /*
+    What --stream passes from the sims of the first guessed round on its
+    own to the workers guessing every round: the sims waiting to be
+    used, and every result each team has had in any of them so far,
+    like --estimates would have from a finished file
+    */
+public:
+    SampleQueue<std::vector<int>> queue;
+    std::vector<std::atomic<unsigned char>> seen; // Bit R for result R
+    std::atomic<int> next_run {0};
+    std::atomic<int> runs {0}; // Finished, unlike next_run
+    std::atomic<int> successes {0};
+    std::atomic<int> producers; // Streamers still going
+
+    FirstRoundFeed(int capacity, int num_teams, int num_producers)
+        : queue {(std::size_t)capacity}, seen(num_teams),
+          producers {num_producers} {}
+
+    std::vector<unsigned char> seen_so_far() const {
+        std::vector<unsigned char> snapshot(seen.size());
+        for (int team {0}; team < (int)seen.size(); team++) {
+            snapshot[team] = seen[team];
+        }
+        return snapshot;
+    }
+};
+
+
+void stream_first_round(
+    const Draw& draw, const RunOptions& opts, FirstRoundFeed& feed
+) {
+    /*
+    For --stream: sims the first guessed round on its own, as hastytab
+    would, and feeds each success's results to the workers guessing
+    every round, until they close the queue. Run n is seeded from
+    (seed, 2^32 + n), to keep clear of the workers' runs. Once --runs of
+    the feed's runs have finished without a success it gives up, and the
+    last thread to stop closes the queue, since the workers would
+    otherwise wait forever
+    */
+    SearchState st {draw};
+    std::vector<int> iterations {round_iterations(draw, opts)};
+    while (!feed.queue.is_closed()) {
+        if (feed.runs >= opts.runs && feed.successes == 0) break;
+        int run_num {feed.next_run++};
+        st.rng.seed(opts.seed, (std::uint64_t {1} << 32) + run_num);
+        int global_loss {};
+        bool success {single_full_run(st, draw, iterations, global_loss, opts)};
+        if (!success) {
+            feed.runs++;
+            continue;
+        }
+        std::vector<int> results {st.est[0]};
+        for (int team {0}; team < draw.num_teams(); team++) {
+            feed.seen[team] |= 1 << results[team];
+        }
+        feed.successes++; // Before runs, so nobody gives up on it
+        feed.runs++;
+        if (!feed.queue.push(results)) break;
+    }
+    if (--feed.producers == 0) feed.queue.close();
+}
+
+
+void worker_runs(
+    const Draw& draw,
+    const RunOptions& opts,
+    std::atomic<int>& next_run,
+    ResultSink* sink,
+    SampleSummary* summary,
+    RunStats& stats,
+    FirstRoundFeed* feed=nullptr
+) {
+    /*
+    Each worker takes run numbers off next_run until they're all gone.
+    With --stream, each run also takes a sim of the first round off the
+    feed to start from, with that round narrowed down to the results
+    the feed has seen so far, in the worker's own copy of the draw
+    */
+    Draw own_draw {};
+    if (feed) own_draw = draw;
+    const Draw& run_draw {(feed) ? own_draw : draw};
+    SearchState st {draw};
+    std::vector<int> iterations {round_iterations(draw, opts)};
+    if (feed) iterations[0] = opts.narrowed_iterations;
+    std::vector<int> first_round {};
+    std::vector<const std::vector<int>*> results {};
+    for (const std::vector<int>& round_est : st.est) {
+        results.push_back(&round_est);
+    }
+    int run_num {};
+    while ((run_num = next_run++) < opts.runs) {
+        if (feed) {
+            if (!feed->queue.pop(first_round)) return;
+            std::vector<unsigned char> seen {feed->seen_so_far()};
+            for (Room& room : own_draw.rounds[0].rooms) {
+                narrow_to_seen(room, seen);
+            }
+            own_draw.rounds[0].narrowed = true;
+        }
+        st.rng.seed(opts.seed, run_num); // Same run, same sim, any worker
+        int global_loss {};
+        bool success {single_full_run(
+            st, run_draw, iterations, global_loss, opts,
+            (feed) ? &first_round : nullptr
+        )};
+        stats.runs++;
+        stats.successes += success;
+        stats.orders_scored += st.orders_scored;
+        st.orders_scored = 0;
+        if (success && sink) export_prediction(st, *sink);
+        if (success && summary) summary->add_sim(results);
+        std::lock_guard<std::mutex> lock {output_mutex};
+        std::cout << "STARTING iteration " << run_num + 1 << ":\t";
+        if (success) {
+            std::cout << "\tSUCCESS - exporting; loss " << global_loss << "\n";
+        } else {
+            std::cout << "\tFAILURE - starting again, loss " << global_loss;
+            std::cout << "\n";
+        }
+    }
+}
+
+
+class ExactComponent {
+    /*
+    Rooms of the guessed rounds that --exact has to decide together:
+    those with more than one possible order that link to the same later
+    room, or could put a team inside the score range of the same later
+    room. region holds every later room whose sandwich loss they can
+    sway, and linked the ones whose teams' scores they can change.
+    The only other rooms they interact with are through pullups at the
+    buckets shared with other components (see ExactProblem), so each
+    solution records how many pullups it puts at each of those
+    */
+public:
+    std::vector<int> rooms {}; // Guessed room ids, earliest first
+    std::vector<std::vector<int>> region {}; // [layer] later room ids
+    std::vector<std::vector<int>> linked {}; // [layer] later room ids
+    std::vector<unsigned char> picks {}; // Candidate per room, per solution
+    std::vector<std::vector<int>> usages {}; // Pullups at shared buckets
+    std::vector<std::vector<int>> usage_solutions {}; // Solutions, per usage
+    std::map<std::vector<int>, int> usage_ids {}; // Back into usages
+    long long solutions {0};
+    long long nodes {0}; // Search tree nodes visited
+    bool solved {false}; // Finished within --exact-limit nodes
+};
+
+
+class ExactProblem {
+    /*
+    What --exact works with: the components, the pullups that nothing
+    can change, and the buckets where more than one component could
+    push the pullups over 3, which are all that ties components together
+    */
+public:
+    std::vector<ExactComponent> components {};
+    std::vector<std::vector<int>> fixed_pullups {}; // [layer][score]
+    std::vector<std::array<int, 2>> shared {}; // Layer and score
+    std::vector<std::vector<int>> shared_index {}; // [layer][score], or -1
+    int outside_loss {0}; // Loss that no room with a choice can sway
+};
+
+
+const Room& guessed_room(const Draw& draw, int id) {
+    int u {guessed_round_of(draw, id)};
+    return draw.rounds[u].rooms[id - draw.rounds[u].first_id];
+}
+
+
+void set_fixed_rooms(SearchState& st, const Draw& draw) {
+    // Every room gets its first possible order, and the globals to match
+    reset_results(st, draw);
+    for (int u {0}; u < draw.num_guessed(); u++) {
+        const Round& round {draw.rounds[u]};
+        for (int room_id {0}; room_id < (int)round.rooms.size(); room_id++) {
+            const CandidateOrders& poss_orders {
+                round.rooms[room_id].poss_orders
+            };
+            set_order_update_glob(
+                st, draw, u, room_id,
+                (poss_orders.size > 0) ? poss_orders[0]
+                                       : std::array<int, 4> {0, 0, 0, 0}
+            );
+        }
+    }
+}
+
+
+ExactProblem build_exact_problem(const SearchState& st, const Draw& draw) {
+    /*
+    Splits the rooms with more than one possible order into components,
+    given st from set_fixed_rooms. How far every team's score can range
+    comes from the rooms' possible orders, so the fewer orders rooms
+    have, the smaller the components
+    */
+    int num_layers {(int)draw.rounds.size()};
+    std::vector<std::vector<int>> low {};
+    std::vector<std::vector<int>> high {};
+    score_ranges(draw, low, high);
+    int num_rooms {draw.num_guessed_rooms()};
+    std::vector<int> parent(num_rooms);
+    for (int id {0}; id < num_rooms; id++) parent[id] = id;
+    std::vector<std::vector<std::vector<int>>> swayed(num_rooms);
+    std::vector<std::vector<int>> room_owner(num_layers);
+    for (int w {1}; w < num_layers; w++) {
+        room_owner[w].assign(draw.rounds[w].rooms.size(), -1);
+    }
+    for (int id {0}; id < num_rooms; id++) {
+        const Room& room {guessed_room(draw, id)};
+        if (room.poss_orders.size < 2) continue;
+        int u {guessed_round_of(draw, id)};
+        int room_id {id - draw.rounds[u].first_id};
+        swayed[id].resize(num_layers);
+        for (int w {u + 1}; w < num_layers; w++) {
+            const Round& later {draw.rounds[w]};
+            std::set<int> rooms_swayed {};
+            for (int later_id : draw.rounds[u].later_rooms[w][room_id]) {
+                rooms_swayed.insert(later_id);
+            }
+            for (int later_id {0}; later_id < (int)later.rooms.size();
+                 later_id++) {
+                int span_lo {draw.num_scores};
+                int span_hi {0};
+                for (int team : later.rooms[later_id].teams) {
+                    span_lo = std::min(span_lo, low[w][team]);
+                    span_hi = std::max(span_hi, high[w][team]);
+                }
+                for (int team : room.teams) {
+                    if (std::max(low[w][team], span_lo + 1)
+                        <= std::min(high[w][team], span_hi - 1)) {
+                        rooms_swayed.insert(later_id);
+                    }
+                }
+            }
+            for (int later_id : rooms_swayed) {
+                int& owner {room_owner[w][later_id]};
+                if (owner == -1) owner = id;
+                parent[find_component(parent, id)]
+                    = find_component(parent, owner);
+                swayed[id][w].push_back(later_id);
+            }
+        }
+    }
+    ExactProblem problem {};
+    std::vector<int> component_of(num_rooms, -1);
+    std::vector<std::vector<bool>> variable(num_layers);
+    for (int w {1}; w < num_layers; w++) {
+        variable[w].assign(draw.rounds[w].rooms.size(), false);
+    }
+    for (int id {0}; id < num_rooms; id++) {
+        if (swayed[id].empty()) continue;
+        int root {find_component(parent, id)};
+        if (component_of[root] == -1) {
+            component_of[root] = (int)problem.components.size();
+            problem.components.emplace_back();
+            problem.components.back().region.resize(num_layers);
+            problem.components.back().linked.resize(num_layers);
+        }
+        ExactComponent& component {problem.components[component_of[root]]};
+        component.rooms.push_back(id);
+        int u {guessed_round_of(draw, id)};
+        for (int w {u + 1}; w < num_layers; w++) {
+            std::vector<int>& region {component.region[w]};
+            region.insert(region.end(), swayed[id][w].begin(),
+                          swayed[id][w].end());
+            for (int later_id :
+                 draw.rounds[u].later_rooms[w][id - draw.rounds[u].first_id]) {
+                component.linked[w].push_back(later_id);
+                variable[w][later_id] = true;
+            }
+        }
+    }
+    for (ExactComponent& component : problem.components) {
+        for (int w {1}; w < num_layers; w++) {
+            for (std::vector<int>* ids :
+                 {&component.region[w], &component.linked[w]}) {
+                std::sort(ids->begin(), ids->end());
+                ids->erase(std::unique(ids->begin(), ids->end()), ids->end());
+            }
+        }
+    }
+    // Pullups nothing can change, and who could add to them where
+    problem.fixed_pullups.resize(num_layers);
+    problem.shared_index.resize(num_layers);
+    for (int w {1}; w < num_layers; w++) {
+        const Round& later {draw.rounds[w]};
+        const Layer& layer {st.layers[w]};
+        std::vector<int>& fixed {problem.fixed_pullups[w]};
+        fixed.assign(draw.num_scores, 0);
+        std::vector<int> most(draw.num_scores, 0);
+        std::vector<int> touching(draw.num_scores, 0);
+        std::vector<bool> swayable(later.rooms.size(), false);
+        for (ExactComponent& component : problem.components) {
+            std::vector<bool> touches(draw.num_scores, false);
+            for (int later_id : component.linked[w]) {
+                for (int team : later.rooms[later_id].teams) {
+                    for (int s {low[w][team]}; s <= high[w][team]; s++) {
+                        most[s]++;
+                        touches[s] = true;
+                    }
+                }
+            }
+            for (int s {0}; s < draw.num_scores; s++) touching[s] += touches[s];
+            for (int later_id : component.region[w]) swayable[later_id] = true;
+        }
+        for (int later_id {0}; later_id < (int)later.rooms.size();
+             later_id++) {
+            if (!swayable[later_id]) {
+                problem.outside_loss += get_room_sandwich_loss(st, w, later_id);
+            }
+            if (variable[w][later_id]) continue;
+            for (int pullup : layer.rooms[later_id].pullup_list()) {
+                fixed[pullup]++;
+            }
+        }
+        problem.shared_index[w].assign(draw.num_scores, -1);
+        for (int s {0}; s < draw.num_scores; s++) {
+            if (touching[s] == 0) {
+                problem.outside_loss += std::max(0, fixed[s] - 3);
+            }
+            if (touching[s] < 2 || fixed[s] + most[s] <= 3) continue;
+            problem.shared_index[w][s] = (int)problem.shared.size();
+            problem.shared.push_back({w, s});
+        }
+    }
+    return problem;
+}
+
+
+class ExactOpenings {
+    /*
+    Which later rooms still have a team from a room solve_component
+    hasn't assigned yet, counted per later room ([layer][later room]),
+    and kept up to date as it assigns rooms and takes them back, so the
+    bound needn't look for open teams. open_below is scratch space for
+    the bound
+    */
+public:
+    std::vector<std::vector<int>> rooms {};
+    std::vector<int> open_below {}; // [score] open teams scoring under it
+};
+
+
+void change_openings(
+    const Draw& draw, ExactOpenings& openings, int id, int change
+) {
+    // Opens (change 1) or closes (change -1) guessed room id's teams
+    int u {guessed_round_of(draw, id)};
+    for (int w {u + 1}; w < (int)draw.rounds.size(); w++) {
+        const Round& later {draw.rounds[w]};
+        for (int team : guessed_room(draw, id).teams) {
+            int later_id {later.room_of_team[team]};
+            if (later_id != -1) openings.rooms[w][later_id] += change;
+        }
+    }
+}
+
+
+ExactOpenings open_component(
+    const Draw& draw, const ExactComponent& component
+) {
+    // Every room of the component open, as solve_component starts
+    ExactOpenings openings {};
+    openings.rooms.resize(draw.rounds.size());
+    for (int w {1}; w < (int)draw.rounds.size(); w++) {
+        openings.rooms[w].assign(draw.rounds[w].rooms.size(), 0);
+    }
+    for (int id : component.rooms) change_openings(draw, openings, id, 1);
+    return openings;
+}
+
+
+int component_loss_bound(
+    const SearchState& st,
+    const Draw& draw,
+    const ExactProblem& problem,
+    const ExactComponent& component,
+    int assigned,
+    ExactOpenings& openings,
+    std::vector<int>* usage=nullptr
+) {
+    /*
+    A lower bound on the component's part of the loss, whatever the
+    rooms from assigned onwards end up with. Those rooms' teams are left
+    out of sandwich counts (once per open room they're in), and rooms
+    they're in are left out altogether, which can't make any count
+    bigger than it will be. Its pullups only count alongside the ones
+    nothing can change, so a shared bucket is only ruled out once this
+    component alone takes it over 3. Once every room is assigned it's
+    exact for everything but the shared buckets, and usage gets the
+    pullups at each of those
+    */
+    int num_layers {(int)draw.rounds.size()};
+    if (usage) usage->assign(problem.shared.size(), 0);
+    int bound {0};
+    std::vector<int> pullups {};
+    std::vector<int>& open_below {openings.open_below};
+    for (int w {1}; w < num_layers; w++) {
+        const Layer& layer {st.layers[w]};
+        const std::vector<int>& open_rooms {openings.rooms[w]};
+        open_below.assign(draw.num_scores + 1, 0);
+        for (int j {assigned}; j < (int)component.rooms.size(); j++) {
+            int id {component.rooms[j]};
+            if (guessed_round_of(draw, id) >= w) continue;
+            for (int team : guessed_room(draw, id).teams) {
+                open_below[layer.scores[team] + 1]++;
+            }
+        }
+        for (int score {1}; score <= draw.num_scores; score++) {
+            open_below[score] += open_below[score - 1];
+        }
+        for (int later_id : component.region[w]) {
+            if (open_rooms[later_id] > 0) continue;
+            const RoomState& room_state {layer.rooms[later_id]};
+            int loss {get_room_sandwich_loss(st, w, later_id)};
+            int lo {room_state.min_score() + 1};
+            int hi {room_state.max_score()}; // Strictly inside is lo to hi - 1
+            if (lo < hi) loss -= open_below[hi] - open_below[lo];
+            bound += std::max(0, loss);
+        }
+        pullups = problem.fixed_pullups[w];
+        for (int later_id : component.linked[w]) {
+            if (open_rooms[later_id] > 0) continue;
+            for (int pullup : layer.rooms[later_id].pullup_list()) {
+                pullups[pullup]++;
+                int shared {problem.shared_index[w][pullup]};
+                if (usage && shared != -1) (*usage)[shared]++;
+            }
+        }
+        for (int s {0}; s < draw.num_scores; s++) {
+            bound += std::max(0, pullups[s] - 3);
+        }
+    }
+    return bound;
+}
+
+
+void solve_component(
+    SearchState& st,
+    const Draw& draw,
+    const ExactProblem& problem,
+    ExactComponent& component,
+    ExactOpenings& openings,
+    long long node_limit,
+    int assigned=0
+) {
+    /*
+    Branch and bound over the component's rooms in turn, keeping every
+    assignment with none of the loss that's its alone, grouped by its
+    pullups at the shared buckets. Rooms not reached yet hold whatever
+    they had, which the bound ignores. Gives up, leaving solved false,
+    once node_limit nodes have been visited
+    */
+    if (assigned == 0) component.solved = true;
+    if (!component.solved) return;
+    if (++component.nodes > node_limit) {
+        component.solved = false;
+        return;
+    }
+    int num_rooms {(int)component.rooms.size()};
+    std::vector<int> usage {};
+    bool done {assigned == num_rooms};
+    if (component_loss_bound(
+            st, draw, problem, component, assigned, openings,
+            (done) ? &usage : nullptr
+        ) > 0) {
+        return;
+    }
+    if (done) {
+        for (int id : component.rooms) {
+            int u {guessed_round_of(draw, id)};
+            int room_id {id - draw.rounds[u].first_id};
+            component.picks.push_back(current_candidate(st, draw, u, room_id));
+        }
+        auto found = component.usage_ids.emplace(
+            usage, (int)component.usages.size()
+        );
+        if (found.second) {
+            component.usages.push_back(usage);
+            component.usage_solutions.emplace_back();
+        }
+        component.usage_solutions[found.first->second].push_back(
+            (int)component.solutions++
+        );
+        return;
+    }
+    int id {component.rooms[assigned]};
+    int u {guessed_round_of(draw, id)};
+    int room_id {id - draw.rounds[u].first_id};
+    const CandidateOrders& poss_orders {
+        draw.rounds[u].rooms[room_id].poss_orders
+    };
+    change_openings(draw, openings, id, -1);
+    for (int k {0}; k < poss_orders.size; k++) {
+        set_order_update_glob(st, draw, u, room_id, poss_orders[k]);
+        solve_component(
+            st, draw, problem, component, openings, node_limit, assigned + 1
+        );
+    }
+    change_openings(draw, openings, id, 1);
+}
+
+
+using ResultCount = std::uint64_t;
+using UsageCounts = std::map<std::vector<int>, ResultCount>;
+
+
+ResultCount add_counts(ResultCount a, ResultCount b) {
+    // Throws rather than wrap, since --exact's counts are meant to be exact
+    if (a > std::numeric_limits<ResultCount>::max() - b) {
+        throw std::overflow_error("Too many zero-loss results to count");
+    }
+    return a + b;
+}
+
+
+ResultCount multiply_counts(ResultCount a, ResultCount b) {
+    if (b != 0 && a > std::numeric_limits<ResultCount>::max() / b) {
+        throw std::overflow_error("Too many zero-loss results to count");
+    }
+    return a * b;
+}
+
+
+std::vector<UsageCounts> count_exact_results(const ExactProblem& problem) {
+    /*
+    Stage k counts the ways the first k components can go together, by
+    their total pullups at each shared bucket, never letting a bucket go
+    over 3. The last stage adds up to the number of zero-loss results
+    */
+    std::vector<UsageCounts> stages(problem.components.size() + 1);
+    stages[0][std::vector<int>(problem.shared.size(), 0)] = 1;
+    for (int k {0}; k < (int)problem.components.size(); k++) {
+        const ExactComponent& component {problem.components[k]};
+        for (const auto& [before, ways] : stages[k]) {
+            for (int i {0}; i < (int)component.usages.size(); i++) {
+                std::vector<int> after {before};
+                bool fits {true};
+                for (int b {0}; b < (int)after.size(); b++) {
+                    after[b] += component.usages[i][b];
+                    const std::array<int, 2>& bucket {problem.shared[b]};
+                    fits &= problem.fixed_pullups[bucket[0]][bucket[1]]
+                        + after[b] <= 3;
+                }
+                if (!fits) continue;
+                ResultCount& count {stages[k + 1][after]};
+                count = add_counts(count, multiply_counts(
+                    ways, component.usage_solutions[i].size()
+                ));
+            }
+        }
+    }
+    return stages;
+}
+
+
+std::vector<int> draw_exact_result(
+    const ExactProblem& problem,
+    const std::vector<UsageCounts>& stages,
+    Rng& rng
+) {
+    /*
+    A solution per component, drawn uniformly from all the zero-loss
+    results: the total usage in proportion to its count, then back
+    through the components, each usage in proportion to the ways the
+    earlier components can make up the rest
+    */
+    int num_components {(int)problem.components.size()};
+    std::vector<int> chosen(num_components);
+    long double total {0};
+    for (const auto& [usage, ways] : stages.back()) total += ways;
+    long double pick {rng.unit() * total};
+    std::vector<int> left {stages.back().rbegin()->first};
+    for (const auto& [usage, ways] : stages.back()) {
+        pick -= ways;
+        if (pick < 0) {
+            left = usage;
+            break;
+        }
+    }
+    for (int k {num_components - 1}; k >= 0; k--) {
+        const ExactComponent& component {problem.components[k]};
+        std::vector<long double> weights(component.usages.size(), 0);
+        long double sum {0};
+        for (int i {0}; i < (int)component.usages.size(); i++) {
+            std::vector<int> before {left};
+            bool fits {true};
+            for (int b {0}; b < (int)before.size(); b++) {
+                before[b] -= component.usages[i][b];
+                fits &= before[b] >= 0;
+            }
+            auto found = stages[k].find(before);
+            if (!fits || found == stages[k].end()) continue;
+            weights[i] = (long double)found->second
+                * component.usage_solutions[i].size();
+            sum += weights[i];
+        }
+        pick = rng.unit() * sum;
+        int usage {0};
+        while (usage + 1 < (int)weights.size()
+               && (weights[usage] == 0 || (pick -= weights[usage]) >= 0)) {
+            usage++;
+        }
+        const std::vector<int>& solutions {component.usage_solutions[usage]};
+        chosen[k] = solutions[rng.below(solutions.size())];
+        for (int b {0}; b < (int)left.size(); b++) {
+            left[b] -= component.usages[usage][b];
+        }
+    }
+    return chosen;
+}
+
+
+void apply_exact_result(
+    SearchState& st,
+    const Draw& draw,
+    const ExactProblem& problem,
+    const std::vector<int>& chosen
+) {
+    for (int k {0}; k < (int)problem.components.size(); k++) {
+        const ExactComponent& component {problem.components[k]};
+        int num_rooms {(int)component.rooms.size()};
+        for (int j {0}; j < num_rooms; j++) {
+            int id {component.rooms[j]};
+            int u {guessed_round_of(draw, id)};
+            int room_id {id - draw.rounds[u].first_id};
+            set_order_update_glob(
+                st, draw, u, room_id,
+                draw.rounds[u].rooms[room_id].poss_orders[
+                    component.picks[(long long)chosen[k] * num_rooms + j]
+                ]
+            );
+        }
+    }
+}
+
+
+void list_exact_results(
+    const ExactProblem& problem,
+    std::vector<int>& chosen,
+    std::vector<int>& used,
+    std::vector<std::vector<int>>& results,
+    int k=0
+) {
+    // Every zero-loss result, as a solution per component
+    if (k == (int)problem.components.size()) {
+        results.push_back(chosen);
+        return;
+    }
+    const ExactComponent& component {problem.components[k]};
+    for (int i {0}; i < (int)component.usages.size(); i++) {
+        bool fits {true};
+        for (int b {0}; b < (int)used.size(); b++) {
+            const std::array<int, 2>& bucket {problem.shared[b]};
+            fits &= problem.fixed_pullups[bucket[0]][bucket[1]] + used[b]
+                + component.usages[i][b] <= 3;
+        }
+        if (!fits) continue;
+        for (int b {0}; b < (int)used.size(); b++) {
+            used[b] += component.usages[i][b];
+        }
+        for (int solution : component.usage_solutions[i]) {
+            chosen[k] = solution;
+            list_exact_results(problem, chosen, used, results, k + 1);
+        }
+        for (int b {0}; b < (int)used.size(); b++) {
+            used[b] -= component.usages[i][b];
+        }
+    }
+}
+
+
+void exact_runs(
+    const Draw& draw,
+    const RunOptions& opts,
+    ResultSink* sink,
+    SampleSummary* summary,
+    RunStats& stats
+) {
+    /*
+    --exact: solves every component with branch and bound instead of
+    searching, and counts the zero-loss results exactly by putting the
+    components back together over the shared buckets. If there are no
+    more than --runs of them it exports them all, and otherwise --runs
+    drawn uniformly (sim n from (seed, n))
+    */
+    SearchState st {draw};
+    set_fixed_rooms(st, draw);
+    ExactProblem problem {build_exact_problem(st, draw)};
+    std::cout << "Loss no choice can sway: " << problem.outside_loss << "\n";
+    std::cout << "Shared buckets: " << problem.shared.size() << "\n";
+    const int most_rooms {64}; // Past this there's no finishing the tree
+    for (int k {0}; k < (int)problem.components.size(); k++) {
+        int num_rooms {(int)problem.components[k].rooms.size()};
+        if (num_rooms <= most_rooms) continue;
+        throw std::runtime_error(
+            "Component " + std::to_string(k + 1) + " has "
+            + std::to_string(num_rooms) + " rooms with a choice, more than "
+            + std::to_string(most_rooms) + " is too many for --exact"
+        );
+    }
+    bool solved {true};
+    for (int k {0}; k < (int)problem.components.size(); k++) {
+        ExactComponent& component {problem.components[k]};
+        ExactOpenings openings {open_component(draw, component)};
+        solve_component(
+            st, draw, problem, component, openings, opts.exact_limit
+        );
+        std::cout << "Component " << k + 1 << ": ";
+        std::cout << component.rooms.size() << " rooms, ";
+        if (component.solved) {
+            std::cout << component.solutions << " solutions, ";
+            std::cout << component.usages.size() << " shared usages\n";
+        } else {
+            std::cout << "gave up after " << opts.exact_limit << " nodes\n";
+        }
+        solved &= component.solved;
+    }
+    if (!solved) {
+        throw std::runtime_error(
+            "Some components are too big for --exact (see --exact-limit)"
+        );
+    }
+    std::vector<UsageCounts> stages {count_exact_results(problem)};
+    ResultCount total {0};
+    if (problem.outside_loss == 0) {
+        for (const auto& [usage, ways] : stages.back()) {
+            total = add_counts(total, ways);
+        }
+    }
+    std::cout << "Zero-loss results in all: " << total << "\n";
+    std::vector<std::vector<int>> every {};
+    if (total > 0 && total <= (ResultCount)opts.runs) {
+        std::vector<int> chosen(problem.components.size(), 0);
+        std::vector<int> used(problem.shared.size(), 0);
+        list_exact_results(problem, chosen, used, every);
+    }
+    int num_sims {(total == 0) ? 0 : (every.empty()) ? opts.runs
+                                                      : (int)every.size()};
+    std::vector<const std::vector<int>*> results {};
+    for (const std::vector<int>& round_est : st.est) {
+        results.push_back(&round_est);
+    }
+    for (int sim_num {0}; sim_num < num_sims; sim_num++) {
+        st.rng.seed(opts.seed, sim_num);
+        apply_exact_result(
+            st, draw, problem, (every.empty())
+                ? draw_exact_result(problem, stages, st.rng) : every[sim_num]
+        );
+#ifdef CHECK_LOSSES
+        assert(get_global_loss(st, draw) == 0);
+#endif
+        stats.runs++;
+        stats.successes++;
+        if (sink) export_prediction(st, *sink);
+        if (summary) summary->add_sim(results);
+    }
+}
+
+
+double replica_temperature(const RunOptions& opts, int slot) {
+    /*
+    Slot 0 is the cold replica, near enough greedy, and the rest go up
+    geometrically to --temperature, so neighbours swap about as readily
+    all the way up
+    */
+    const double coldest {0.1};
+    double hottest {std::max(coldest, opts.strategy.temperature)};
+    if (opts.replicas < 2) return coldest;
+    return coldest * std::pow(
+        hottest / coldest, (double)slot / (opts.replicas - 1)
+    );
+}
+
+
+void tempering_sweeps(SearchState& st, const Draw& draw, int sweeps) {
+    // One replica's share of the work between swaps, at its temperature
+    for (int i {0}; i < sweeps; i++) {
+        for (int u {0}; u < draw.num_guessed(); u++) {
+            for (int room_id {0}; room_id < (int)draw.rounds[u].rooms.size();
+                 room_id++) {
+                optimise_single_room(st, draw, u, room_id);
+            }
+        }
+    }
+}
+
+
+void tempering_runs(
+    const Draw& draw,
+    const RunOptions& opts,
+    ResultSink* sink,
+    SampleSummary* summary,
+    RunStats& stats
+) {
+    /*
+    Parallel tempering in place of restarts: --tempering K replicas each
+    sweep at a fixed temperature on a pool thread of their own, then at every
+    swap, neighbouring temperatures trade replicas with the usual
+    Metropolis chance, min(1, exp((1/T_i - 1/T_j)(loss_i - loss_j))).
+    Hot replicas wander out of basins and hand what they find down the
+    ladder, so nothing is thrown away. Each swap counts as a run, a
+    success when the coldest replica is down to the threshold, and that
+    replica is the one exported. Samples from one chain are correlated,
+    so it takes more of them to match the same number of restarts.
+    Replica k is seeded from (seed, k) and the swaps from (seed, K), so
+    the output doesn't depend on how the threads get scheduled
+    */
+    int num_replicas {opts.replicas};
+    std::vector<std::unique_ptr<SearchState>> replicas {};
+    for (int k {0}; k < num_replicas; k++) {
+        replicas.emplace_back(new SearchState {draw});
+        SearchState& st {*replicas.back()};
+        st.rng.seed(opts.seed, k);
+        reset_results(st, draw);
+        st.chooser.start_run(opts.strategy, draw.num_guessed_rooms());
+    }
+    std::vector<int> slot_replica(num_replicas); // Coldest first
+    std::vector<double> temperatures(num_replicas);
+    for (int slot {0}; slot < num_replicas; slot++) {
+        slot_replica[slot] = slot;
+        temperatures[slot] = replica_temperature(opts, slot);
+    }
+    std::vector<int> losses(num_replicas, 0);
+    Rng swap_rng {};
+    swap_rng.seed(opts.seed, num_replicas);
+    long long swaps_tried {0};
+    long long swaps_made {0};
+    WorkPool pool {num_replicas}; // Kept for every swap, not restarted
+    for (int run_num {0}; run_num < opts.runs; run_num++) {
+        pool.run([&](int slot) {
+            SearchState& st {*replicas[slot_replica[slot]]};
+            st.chooser.fix_temperature(temperatures[slot]);
+            tempering_sweeps(st, draw, opts.swap_every);
+            losses[slot_replica[slot]] = get_global_loss(st, draw);
+        });
+        // Alternate which neighbours get to swap, so each pair is tried
+        for (int slot {run_num % 2}; slot + 1 < num_replicas; slot += 2) {
+            int cold {slot_replica[slot]};
+            int hot {slot_replica[slot + 1]};
+            double exponent {
+                (1 / temperatures[slot] - 1 / temperatures[slot + 1])
+                * (losses[cold] - losses[hot])
+            };
+            swaps_tried++;
+            if (exponent < 0 && swap_rng.unit() >= std::exp(exponent)) {
+                continue;
+            }
+            std::swap(slot_replica[slot], slot_replica[slot + 1]);
+            swaps_made++;
+        }
+        SearchState& coldest {*replicas[slot_replica[0]]};
+        int global_loss {losses[slot_replica[0]]};
+        bool success {global_loss <= opts.threshold};
+        stats.runs++;
+        stats.successes += success;
+        if (success && sink) export_prediction(coldest, *sink);
+        if (success && summary) {
+            std::vector<const std::vector<int>*> results {};
+            for (const std::vector<int>& round_est : coldest.est) {
+                results.push_back(&round_est);
+            }
+            summary->add_sim(results);
+        }
+        std::cout << "STARTING iteration " << run_num + 1 << ":\t";
+        if (success) {
+            std::cout << "\tSUCCESS - exporting; loss " << global_loss << "\n";
+        } else {
+            std::cout << "\tFAILURE - sweeping on, loss " << global_loss;
+            std::cout << "\n";
+        }
+    }
+    for (std::unique_ptr<SearchState>& st : replicas) {
+        stats.orders_scored += st->orders_scored;
+    }
+    std::cout << "Swaps made: " << swaps_made << " of " << swaps_tried;
+    std::cout << "\n";
+}
+
+
+void multi_runs(
+    const Draw& draw,
+    const RunOptions& opts,
+    std::string filename,
+    const Draw* first_draw=nullptr
+) {
+    /*
+    Restarts are independent, so spread them over the worker threads.
+    With --stream, first_draw is the first guessed round on its own, and
+    --stream-threads more threads sim it to feed the workers through a
+    queue
+    */
+    auto start_time = std::chrono::steady_clock::now();
+    std::string header {get_header(draw)};
+    int row_bytes {0};
+    if (opts.binary) {
+        SampleHeader sample_header {get_sample_header(draw, opts.seed)};
+        header = sample_header.encode();
+        row_bytes = sample_header.row_bytes();
+    }
+    std::unique_ptr<ResultSink> sink {};
+    if (opts.rows) {
+        sink.reset(
+            new ResultSink {filename, header, opts.shared_file, row_bytes}
+        );
+    }
+    std::unique_ptr<SampleSummary> summary {};
+    if (!opts.summary.empty() || opts.bench) { // --bench keeps its own
+        std::vector<int> pair_teams {};
+        if (!opts.pairs.empty()) {
+            pair_teams = read_team_list(opts.pairs, TeamIndex {draw.names});
+        }
+        summary.reset(new SampleSummary {
+            opts.summary, draw.names, draw.guessed_numbers(), pair_teams,
+            opts.summary_every
+        });
+        summary->flush(); // Workers can't report a bad path, so try it now
+    }
+    std::vector<std::unique_ptr<ResultSink>> shard_sinks;
+    if (opts.rows && opts.shards && !opts.exact && opts.replicas == 0) {
+        for (int i {0}; i < opts.threads; i++) {
+            shard_sinks.emplace_back(new ResultSink {
+                shard_filename(filename, i), header, false, row_bytes
+            });
+        }
+    }
+    std::atomic<int> next_run {opts.first_run};
+    RunStats stats {};
+    std::vector<std::thread> workers;
+    bool restarts {!opts.exact && opts.replicas == 0};
+    if (opts.exact) {
+        exact_runs(draw, opts, sink.get(), summary.get(), stats);
+    } else if (opts.replicas > 0) {
+        tempering_runs(draw, opts, sink.get(), summary.get(), stats);
+    }
+    std::unique_ptr<FirstRoundFeed> feed {};
+    std::vector<std::thread> streamers;
+    if (first_draw) {
+        // Enough to keep every worker going while the next ones are simmed
+        feed.reset(new FirstRoundFeed {
+            4 * opts.threads + 4, first_draw->num_teams(), opts.stream_threads
+        });
+        for (int i {0}; i < opts.stream_threads; i++) {
+            streamers.emplace_back(
+                stream_first_round, std::cref(*first_draw), std::cref(opts),
+                std::ref(*feed)
+            );
+        }
+    }
+    for (int i {0}; i < opts.threads && restarts; i++) {
+        ResultSink* worker_sink {
+            (shard_sinks.empty()) ? sink.get() : shard_sinks[i].get()
+        };
+        workers.emplace_back(
+            worker_runs, std::cref(draw), std::cref(opts),
+            std::ref(next_run), worker_sink, summary.get(), std::ref(stats),
+            feed.get()
+        );
+    }
+    for (std::thread& worker : workers) worker.join();
+    if (feed) {
+        feed->queue.close();
+        for (std::thread& streamer : streamers) streamer.join();
+        std::cout << "Round " << first_draw->rounds[0].number << " sims: ";
+        std::cout << feed->successes << " of " << feed->runs << " runs\n";
+        if (stats.runs < opts.runs - opts.first_run) {
+            int number {first_draw->rounds[0].number};
+            throw std::runtime_error(
+                "--stream: no round " + std::to_string(number)
+                + " sim succeeded in " + std::to_string(opts.runs) + " runs"
+            );
+        }
+    }
+    if (summary) summary->flush();
+    if (!shard_sinks.empty()) {
+        shard_sinks.clear(); // Closes the shard files
+        merge_shards(*sink, filename, opts.threads);
+    }
+    if (opts.bench) {
+        std::chrono::duration<double> wall_time {
+            std::chrono::steady_clock::now() - start_time
+        };
+        print_bench_report(stats, wall_time.count());
+        print_accuracy(*summary, opts.answers, TeamIndex {draw.names});
+    }
+}
+
+
+std::vector<std::string> parse_options(
+    int argc, char* argv[], RunOptions& opts
+) {
+    /*
+    Fills in opts from the flags, and returns the other arguments. Throws
+    on a flag it doesn't know or a value that isn't a number
+    */
+    std::vector<std::string> args;
+    for (int i {1}; i < argc; i++) {
+        std::string arg {argv[i]};
+        try {
+            if (arg == "--threads" && i + 1 < argc) {
+                opts.threads = std::max(1, std::stoi(argv[++i]));
+            } else if (arg == "--shared-file") {
+                opts.shared_file = true;
+            } else if (arg == "--shards") {
+                opts.shards = true;
+            } else if (arg == "--binary") {
+                opts.binary = true;
+            } else if (arg == "--bench") {
+                opts.bench = true;
+            } else if (arg == "--runs" && i + 1 < argc) {
+                opts.runs = std::max(1, std::stoi(argv[++i]));
+            } else if (arg == "--no-rows") {
+                opts.rows = false;
+            } else if (arg == "--summary" && i + 1 < argc) {
+                opts.summary = argv[++i];
+            } else if (arg == "--pairs" && i + 1 < argc) {
+                opts.pairs = argv[++i];
+            } else if (arg == "--summary-every" && i + 1 < argc) {
+                opts.summary_every = std::max(1, std::stoi(argv[++i]));
+            } else if (arg == "--seed" && i + 1 < argc) {
+                opts.seed = std::stoull(argv[++i]);
+            } else if (arg == "--run" && i + 1 < argc) {
+                opts.runs = std::max(1, std::stoi(argv[++i]));
+                opts.first_run = opts.runs - 1; // As numbered in the output
+                opts.replay = true;
+            } else if (arg == "--guess" && i + 1 < argc) {
+                std::string range {argv[++i]}; // K-M, or just K
+                size_t dash {range.find('-')};
+                opts.first_round = std::stoi(range.substr(0, dash));
+                opts.last_round = (dash == std::string::npos)
+                    ? opts.first_round : std::stoi(range.substr(dash + 1));
+                opts.last_round = std::max(opts.first_round, opts.last_round);
+            } else if (arg == "--strategy" && i + 1 < argc) {
+                opts.strategy.name = argv[++i];
+            } else if (arg == "--temperature" && i + 1 < argc) {
+                opts.strategy.temperature = std::stod(argv[++i]);
+            } else if (arg == "--tenure" && i + 1 < argc) {
+                opts.strategy.tabu_tenure = std::stoi(argv[++i]);
+            } else if (arg == "--kicks" && i + 1 < argc) {
+                opts.strategy.kicks = std::max(0, std::stoi(argv[++i]));
+            } else if (arg == "--kick-share" && i + 1 < argc) {
+                opts.strategy.kick_share = std::stod(argv[++i]);
+            } else if (arg == "--tempering" && i + 1 < argc) {
+                opts.replicas = std::max(1, std::stoi(argv[++i]));
+            } else if (arg == "--swap-every" && i + 1 < argc) {
+                opts.swap_every = std::max(1, std::stoi(argv[++i]));
+            } else if (arg == "--split" && i + 1 < argc) {
+                opts.split = std::max(1, std::stoi(argv[++i]));
+            } else if (arg == "--colour-threads" && i + 1 < argc) {
+                opts.colour_threads = std::max(1, std::stoi(argv[++i]));
+            } else if (arg == "--stream") {
+                opts.stream = true;
+            } else if (arg == "--stream-threads" && i + 1 < argc) {
+                opts.stream_threads = std::max(1, std::stoi(argv[++i]));
+            } else if (arg == "--exact") {
+                opts.exact = true;
+            } else if (arg == "--exact-limit" && i + 1 < argc) {
+                opts.exact_limit = std::max(1LL, std::stoll(argv[++i]));
+            } else if (arg == "--full-sweeps") {
+                opts.full_sweeps = true;
+            } else if (arg == "--estimates" && i + 1 < argc) {
+                opts.estimates = argv[++i];
+            } else if (arg.rfind("--", 0) == 0) {
+                throw std::runtime_error(
+                    "unknown option " + arg + ", or it needs a value"
+                );
+            } else {
+                args.push_back(arg);
+            }
+        } catch (const std::logic_error&) { // From std::stoi and the like
+            throw std::runtime_error("bad value for " + arg);
+        }
+    }
+    return args;
+}
+
+
+int run_backtab(
+    std::string directory, std::string filename, RunOptions& opts
+) {
+    // What's left of main once the arguments are sorted out
+    const std::string& strategy {opts.strategy.name};
+    if (strategy != "greedy" && strategy != "anneal" && strategy != "tabu") {
+        std::cerr << "--strategy should be greedy, anneal or tabu\n";
+        return 1;
+    }
+    if (opts.split > 1 && opts.colour_threads > 1) {
+        std::cerr << "--split and --colour-threads don't go together\n";
+        return 1;
+    }
+    if (!opts.rows && opts.summary.empty() && !opts.bench) {
+        std::cerr << "--no-rows only makes sense with --summary\n";
+        return 1;
+    }
+    bool restart_only {
+        opts.replay || opts.threads > 1 || opts.shards || opts.split > 1
+        || opts.colour_threads > 1 || opts.full_sweeps
+        || opts.strategy.kicks != StrategyOptions {}.kicks
+    };
+    if (opts.replicas > 0 && restart_only) {
+        std::cerr << "--tempering runs one chain of plain sweeps on its own "
+                     "threads, so --run, --threads, --shards, --split, "
+                     "--colour-threads, --full-sweeps and --kicks don't "
+                     "apply\n";
+        return 1;
+    }
+    if (opts.stream && (opts.last_round == opts.first_round
+                        || !opts.estimates.empty() || opts.exact
+                        || opts.replicas > 0)) {
+        std::cerr << "--stream needs more than one round to guess, and "
+                     "takes the place of --estimates, --exact and "
+                     "--tempering\n";
+        return 1;
+    }
+    if (opts.stream && opts.replay) {
+        std::cerr << "--stream runs start from whichever sims are ready, "
+                     "so --run can't replay them\n";
+        return 1;
+    }
+    opts.answers = directory + "/answer.csv";
+    std::cout << "Seed " << opts.seed << "\n"; // Needed to replay any run
+    Draw draw {};
+    Draw first_draw {};
+    try {
+        initialise(directory, opts, draw);
+        if (opts.stream) {
+            RunOptions first_opts {opts};
+            first_opts.last_round = first_opts.first_round;
+            initialise(directory, first_opts, first_draw);
+        }
+        multi_runs(draw, opts, filename, (opts.stream) ? &first_draw : nullptr);
+    } catch (const std::exception& error) {
+        std::cerr << error.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
+
+#endif
@@ -0,0 +1,112 @@
+#ifndef BENCH_REPORT_H
+#define BENCH_REPORT_H
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <iostream>
+#include <iomanip>
+#include <sys/resource.h>
+#include "csv_reader.h"
+#include "sample_summary.h"
+
+
+class RunStats {
+    // Totals the workers add to after every run, for --bench
+public:
+    std::atomic<long long> runs {0};
+    std::atomic<long long> successes {0};
+    std::atomic<long long> orders_scored {0}; // Candidate orders scored
+};
+
+
+double peak_rss_mb() {
+    struct rusage usage {};
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss / 1024.0; // Linux gives kilobytes
+}
+
+
+void print_accuracy(
+    const SampleSummary& summary,
+    const std::string& answer_filename,
+    const TeamIndex& ids
+) {
+    /*
+    Compares the tallied results with the true ones in answer.csv
+    (columns name,r7_result,... as the simulator writes them). For each
+    round both cover, prints the mean over teams of the share of sims
+    that gave the team its true result, and the share of teams whose
+    most common sampled result was the true one
+    */
+    if (summary.sims() == 0) {
+        std::cout << "BENCH accuracy n/a, no successful sims\n";
+        return;
+    }
+    MappedFile file {answer_filename};
+    CsvReader reader {file};
+    if (!reader.next_line()) throw reader.error("no header");
+    std::vector<int> column_rounds(reader.size(), -1); // Index into rounds
+    const std::vector<int>& rounds {summary.get_rounds()};
+    for (int col {1}; col < reader.size(); col++) {
+        for (int r {0}; r < (int)rounds.size(); r++) {
+            std::string name {"r" + std::to_string(rounds[r]) + "_result"};
+            if (reader[col] == name) column_rounds[col] = r;
+        }
+    }
+    std::vector<double> share_sum(rounds.size(), 0);
+    std::vector<int> modal_right(rounds.size(), 0);
+    std::vector<int> num_teams(rounds.size(), 0);
+    while (reader.next_line()) {
+        int team {ids.find(reader[0])};
+        if (team == -1) {
+            throw reader.error("unknown team " + std::string(reader[0]));
+        }
+        for (int col {1}; col < reader.size(); col++) {
+            int r {column_rounds[col]};
+            if (r == -1) continue;
+            int truth {reader.parse_int(col)};
+            if (truth < 0 || truth > 3) {
+                throw reader.error("result out of range");
+            }
+            int modal {0};
+            for (int result {1}; result < 4; result++) {
+                if (summary.count(r, team, result)
+                    > summary.count(r, team, modal)) modal = result;
+            }
+            share_sum[r] += (double)summary.count(r, team, truth)
+                / summary.sims();
+            modal_right[r] += modal == truth;
+            num_teams[r]++;
+        }
+    }
+    for (int r {0}; r < (int)rounds.size(); r++) {
+        if (num_teams[r] == 0) continue;
+        std::cout << "BENCH r" << rounds[r] << " accuracy ";
+        std::cout << share_sum[r] / num_teams[r];
+        std::cout << " modal_accuracy ";
+        std::cout << (double)modal_right[r] / num_teams[r] << "\n";
+    }
+}
+
+
+void print_bench_report(const RunStats& stats, double wall_seconds) {
+    // One line, so before/after numbers are easy to diff or grep
+    long long successes {stats.successes};
+    std::cout << std::setprecision(4);
+    std::cout << "BENCH runs " << stats.runs;
+    std::cout << " successes " << successes;
+    std::cout << " success_rate ";
+    std::cout << (double)successes / std::max(1LL, stats.runs.load());
+    std::cout << " wall_s " << wall_seconds;
+    std::cout << " s_per_success ";
+    if (successes > 0) {
+        std::cout << wall_seconds / successes;
+    } else {
+        std::cout << "inf";
+    }
+    std::cout << " orders_per_s " << stats.orders_scored / wall_seconds;
+    std::cout << " peak_rss_mb " << peak_rss_mb() << "\n";
+}
+
+#endif
@@ -0,0 +1,24 @@
+#!/bin/sh
+# Builds both backtabbers and runs them on output_800_5 with fixed seeds,
+# so a change can be judged on the same numbers before and after it.
+# Usage: ./benchmark.sh [r7 runs] [r8 runs] [seed] [extra flags...]
+# Each program prints BENCH lines: wall time per successful sim, success
+# rate, candidate orders scored per second, peak RSS, and how well the
+# sampled results match output_800_5/answer.csv
+set -e
+cd "$(dirname "$0")"
+R7_RUNS=${1:-200}
+R8_RUNS=${2:-100}
+SEED=${3:-1}
+shift $(( $# < 3 ? $# : 3 ))
+BUILD=${BUILD:-${TMPDIR:-/tmp}/hastytab_bench}
+mkdir -p "$BUILD"
+g++ -std=c++17 -O2 -pthread hastytab.cpp -o "$BUILD/hastytab"
+g++ -std=c++17 -O2 -pthread hastytab_r8.cpp -o "$BUILD/hastytab_r8"
+
+echo "== round 7, $R7_RUNS runs, seed $SEED"
+"$BUILD/hastytab" output_800_5 --no-rows --bench \
+    --runs "$R7_RUNS" --seed "$SEED" "$@" | grep BENCH
+echo "== round 8, $R8_RUNS runs, seed $SEED"
+"$BUILD/hastytab_r8" output_800_5 output_800_5/estimates.csv --no-rows \
+    --bench --runs "$R8_RUNS" --seed "$SEED" "$@" | grep BENCH
@@ -0,0 +1,154 @@
+#ifndef CSV_READER_H
+#define CSV_READER_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <stdexcept>
+#include <charconv>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+
+class MappedFile {
+    /*
+    A whole input file mapped read-only, so parsing works straight off
+    the page cache without copying it into strings first
+    */
+public:
+    MappedFile(const std::string& fname) : filename {fname} {
+        int fd {open(filename.c_str(), O_RDONLY)};
+        if (fd < 0) throw std::runtime_error("Can't open " + filename);
+        struct stat file_stat {};
+        fstat(fd, &file_stat);
+        size = file_stat.st_size;
+        if (size > 0) { // mmap won't take an empty file
+            data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data == MAP_FAILED) {
+                close(fd);
+                throw std::runtime_error("Can't map " + filename);
+            }
+            madvise(data, size, MADV_SEQUENTIAL);
+        }
+        close(fd);
+    }
+
+    ~MappedFile() {
+        if (size > 0) munmap(data, size);
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    std::string_view text() const {
+        if (size == 0) return {};
+        return {static_cast<const char*>(data), size};
+    }
+
+    const std::string& name() const { return filename; }
+
+private:
+    std::string filename {};
+    void* data {nullptr};
+    size_t size {0};
+};
+
+
+class CsvReader {
+    /*
+    Steps through a mapped file a line at a time, splitting each line
+    into cells that are just views into the mapping. Blank lines are
+    skipped, and errors carry the file name and line number
+    */
+public:
+    CsvReader(const MappedFile& file)
+        : text {file.text()}, filename {file.name()} {};
+
+    bool next_line() {
+        // Moves on to the next non-blank line; false once there are none
+        while (pos < text.size()) {
+            size_t end {text.find('\n', pos)};
+            if (end == std::string_view::npos) end = text.size();
+            std::string_view line {text.substr(pos, end - pos)};
+            pos = end + 1;
+            line_num++;
+            if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+            if (line.empty()) continue;
+            split(line);
+            return true;
+        }
+        return false;
+    }
+
+    int size() const { return (int)cells.size(); }
+    std::string_view operator[](int i) const { return cells[i]; }
+    int line_number() const { return line_num; }
+
+    std::runtime_error error(const std::string& what) const {
+        return std::runtime_error(
+            filename + ":" + std::to_string(line_num) + ": " + what
+        );
+    }
+
+    int parse_int(int i) const {
+        // Cell i as a whole number, or an error saying which cell it was
+        int value {0};
+        const char* first {cells[i].data()};
+        const char* last {first + cells[i].size()};
+        auto [end, ec] = std::from_chars(first, last, value);
+        if (ec != std::errc {} || end != last || first == last) {
+            std::string cell {cells[i]};
+            throw error("expected a number, got '" + cell + "'");
+        }
+        return value;
+    }
+
+private:
+    std::string_view text {};
+    std::string filename {};
+    size_t pos {0};
+    int line_num {0};
+    std::vector<std::string_view> cells {}; // Reused from line to line
+
+    void split(std::string_view line) {
+        cells.clear();
+        size_t start {0};
+        while (true) {
+            size_t comma {line.find(',', start)};
+            if (comma == std::string_view::npos) {
+                cells.push_back(line.substr(start));
+                return;
+            }
+            cells.push_back(line.substr(start, comma - start));
+            start = comma + 1;
+        }
+    }
+};
+
+
+class TeamIndex {
+    /*
+    Team name to team id, hashed. The keys are views of the names held
+    by the Draw, so only build it once those are final
+    */
+public:
+    TeamIndex() = default;
+    TeamIndex(const std::vector<std::string>& names) {
+        ids.reserve(names.size());
+        for (int id {0}; id < (int)names.size(); id++) ids[names[id]] = id;
+    }
+
+    int find(std::string_view name) const {
+        // Team id, or -1 if nobody has that name
+        auto it = ids.find(name);
+        return (it == ids.end()) ? -1 : it->second;
+    }
+
+private:
+    std::unordered_map<std::string_view, int> ids {};
+};
+
+#endif
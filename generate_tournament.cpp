@@ -0,0 +1,215 @@
+#include <string>
+#include <fstream>
+#include <iostream>
+#include <vector>
+#include <array>
+#include <cmath>
+#include <random>
+#include <algorithm>
+#include <numeric>
+#include <unordered_set>
+#include <stdexcept>
+#include <sys/stat.h>
+#include "rng.h"
+
+
+class TournamentOptions {
+public:
+    int teams {800}; // Must be a multiple of 4 (--teams N)
+    int rounds {9}; // Total rounds drawn (--rounds N)
+    int known {6}; // Rounds in standings.csv, rounds - 3 unless --known N
+    bool normal_skill {true}; // Else uniform (--skill normal|uniform)
+    double spread {1.0}; // Standard deviation, or half-width (--spread X)
+    std::uint64_t seed {1}; // (--seed S)
+};
+
+
+class Tournament {
+    /*
+    A simulated British Parliamentary tournament. Every round is power
+    paired the way the backtabbers assume: teams sorted by points (ties
+    in random order) and cut into rooms of 4 from the top, so a bracket
+    that doesn't fill its last room has that room topped up with teams
+    pulled up from the bracket below. A room's result comes from each
+    team's skill plus Gumbel noise, best gets 3 points and worst 0
+    */
+public:
+    std::vector<std::string> names {};
+    std::vector<double> skill {};
+    std::vector<int> points {};
+    std::vector<std::vector<std::array<int, 4>>> draws {}; // [round][room]
+    std::vector<std::vector<int>> results {}; // [round][team]
+
+    Tournament(const TournamentOptions& opts) : rng {opts.seed, 0} {
+        make_teams(opts);
+        for (int round {0}; round < opts.rounds; round++) play_round();
+    }
+
+private:
+    Rng rng;
+
+    void make_teams(const TournamentOptions& opts) {
+        std::normal_distribution<double> normal {0, opts.spread};
+        std::uniform_real_distribution<double> uniform {
+            -opts.spread, opts.spread
+        };
+        std::unordered_set<std::string> taken {};
+        while ((int)names.size() < opts.teams) {
+            std::string name(16, 'A');
+            for (char& letter : name) letter = 'A' + rng.below(26);
+            if (!taken.insert(name).second) continue;
+            names.push_back(name);
+            skill.push_back(
+                (opts.normal_skill) ? normal(rng) : uniform(rng)
+            );
+        }
+        points.assign(opts.teams, 0);
+    }
+
+    double gumbel() {
+        // Standard Gumbel noise, so rankings follow Plackett-Luce
+        double u {((rng() >> 11) + 0.5) / 9007199254740992.0}; // In (0, 1)
+        return -std::log(-std::log(u));
+    }
+
+    void play_round() {
+        // Power pair on current points, then play every room
+        std::vector<int> order(names.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::shuffle(order.begin(), order.end(), rng); // Random within ties
+        std::stable_sort(
+            order.begin(), order.end(),
+            [this](int a, int b) { return points[a] > points[b]; }
+        );
+        std::vector<std::array<int, 4>> draw {};
+        std::vector<int> round_results(names.size(), 0);
+        for (int first {0}; first < (int)order.size(); first += 4) {
+            std::array<int, 4> room {
+                order[first], order[first + 1],
+                order[first + 2], order[first + 3]
+            };
+            std::shuffle(room.begin(), room.end(), rng); // Positions
+            std::array<double, 4> performance {};
+            for (int i {0}; i < 4; i++) {
+                performance[i] = skill[room[i]] + gumbel();
+            }
+            for (int i {0}; i < 4; i++) {
+                int beaten {0};
+                for (int j {0}; j < 4; j++) {
+                    beaten += performance[i] > performance[j];
+                }
+                round_results[room[i]] = beaten;
+            }
+            draw.push_back(room);
+        }
+        draws.push_back(draw);
+        results.push_back(round_results);
+        for (int team {0}; team < (int)names.size(); team++) {
+            points[team] += round_results[team];
+        }
+    }
+};
+
+
+void write_files(
+    const Tournament& tournament,
+    const TournamentOptions& opts,
+    const std::string& directory
+) {
+    /*
+    Same layout as output_800_5: standings.csv has points after the
+    known rounds, rN_draw.csv the draw of every later round, and
+    answer.csv the true results of the later rounds bar the last, which
+    are the ones a backtab can work out
+    */
+    mkdir(directory.c_str(), 0755);
+    int num_teams {(int)tournament.names.size()};
+    std::ofstream standings(directory + "/standings.csv");
+    standings << "team,points";
+    for (int team {0}; team < num_teams; team++) {
+        int known_points {0};
+        for (int round {0}; round < opts.known; round++) {
+            known_points += tournament.results[round][team];
+        }
+        standings << "\n" << tournament.names[team] << "," << known_points;
+    }
+    for (int round {opts.known}; round < opts.rounds; round++) {
+        std::ofstream draw(
+            directory + "/r" + std::to_string(round + 1) + "_draw.csv"
+        );
+        draw << "og,oo,cg,co";
+        for (const std::array<int, 4>& room : tournament.draws[round]) {
+            draw << "\n" << tournament.names[room[0]];
+            for (int i {1}; i < 4; i++) {
+                draw << "," << tournament.names[room[i]];
+            }
+        }
+    }
+    std::ofstream answer(directory + "/answer.csv");
+    answer << "name";
+    for (int round {opts.known}; round < opts.rounds - 1; round++) {
+        answer << ",r" << round + 1 << "_result";
+    }
+    for (int team {0}; team < num_teams; team++) {
+        answer << "\n" << tournament.names[team];
+        for (int round {opts.known}; round < opts.rounds - 1; round++) {
+            answer << "," << tournament.results[round][team];
+        }
+    }
+    if (!standings || !answer) {
+        throw std::runtime_error("Couldn't write to " + directory);
+    }
+}
+
+
+int main(int argc, char* argv[]) {
+    // e.g. generate_tournament gen_2000 --teams 2000 --seed 3
+    TournamentOptions opts {};
+    std::vector<std::string> args;
+    bool known_given {false};
+    for (int i {1}; i < argc; i++) {
+        std::string arg {argv[i]};
+        try {
+            if (arg == "--teams" && i + 1 < argc) {
+                opts.teams = std::stoi(argv[++i]);
+            } else if (arg == "--rounds" && i + 1 < argc) {
+                opts.rounds = std::stoi(argv[++i]);
+            } else if (arg == "--known" && i + 1 < argc) {
+                opts.known = std::stoi(argv[++i]);
+                known_given = true;
+            } else if (arg == "--skill" && i + 1 < argc) {
+                opts.normal_skill = std::string(argv[++i]) != "uniform";
+            } else if (arg == "--spread" && i + 1 < argc) {
+                opts.spread = std::stod(argv[++i]);
+            } else if (arg == "--seed" && i + 1 < argc) {
+                opts.seed = std::stoull(argv[++i]);
+            } else if (arg.rfind("--", 0) == 0) {
+                std::cerr << "unknown option " << arg
+                    << ", or it needs a value\n";
+                return 1;
+            } else {
+                args.push_back(arg);
+            }
+        } catch (const std::logic_error&) { // From std::stoi and the like
+            std::cerr << "bad value for " << arg << "\n";
+            return 1;
+        }
+    }
+    if (!known_given) opts.known = opts.rounds - 3;
+    if (args.size() != 1 || opts.teams <= 0 || opts.teams % 4 != 0
+        || opts.known < 0 || opts.known >= opts.rounds) {
+        std::cerr << "usage: generate_tournament <output dir> [--teams N]"
+            << " [--rounds N] [--known N] [--skill normal|uniform]"
+            << " [--spread X] [--seed S]\n"
+            << "teams must be a multiple of 4, and known less than rounds\n";
+        return 1;
+    }
+    try {
+        Tournament tournament {opts};
+        write_files(tournament, opts, args[0]);
+    } catch (const std::exception& error) {
+        std::cerr << error.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,247 @@
+#ifndef ORDER_KERNEL_H
+#define ORDER_KERNEL_H
+
+#include <array>
+#include <vector>
+#include <algorithm>
+#include "score_histogram.h"
+#include "room_state.h"
+#include "rng.h"
+
+
+constexpr int num_orders {24};
+using OrderLanes = std::array<int, num_orders>; // One value per order
+
+
+constexpr std::array<std::array<int, 4>, num_orders> make_orders() {
+    // Every permutation of {0,1,2,3}, in lexicographic order
+    std::array<std::array<int, 4>, num_orders> perms {};
+    int k {0};
+    for (int a {0}; a < 4; a++) {
+        for (int b {0}; b < 4; b++) {
+            for (int c {0}; c < 4; c++) {
+                int d {6 - a - b - c};
+                if (a == b || a == c || b == c || d < 0 || d > 3) continue;
+                if (d == a || d == b || d == c) continue;
+                perms[k][0] = a;
+                perms[k][1] = b;
+                perms[k][2] = c;
+                perms[k][3] = d;
+                k++;
+            }
+        }
+    }
+    return perms;
+}
+
+constexpr std::array<std::array<int, 4>, num_orders> orders {make_orders()};
+
+
+class CandidateOrders {
+    /*
+    Up to 24 orders a room might finish in, stored seat-major, so the
+    score seat i gets under each order is one contiguous run of lanes.
+    Lanes past size are left at 0 and get ignored
+    */
+public:
+    std::array<OrderLanes, 4> seat_scores {};
+    int size {0};
+
+    constexpr void add(const std::array<int, 4>& order) {
+        for (int i {0}; i < 4; i++) seat_scores[i][size] = order[i];
+        size++;
+    }
+
+    constexpr std::array<int, 4> operator[](int k) const {
+        return {
+            seat_scores[0][k], seat_scores[1][k],
+            seat_scores[2][k], seat_scores[3][k]
+        };
+    }
+};
+
+
+constexpr CandidateOrders make_all_orders() {
+    CandidateOrders all {};
+    for (const std::array<int, 4>& order : orders) all.add(order);
+    return all;
+}
+
+constexpr CandidateOrders all_orders {make_all_orders()};
+
+
+std::array<int, 4> seats_in_room(
+    const std::array<int, 4>& room_teams, const std::array<int, 4>& moving
+) {
+    // For each team in a later room, its seat in the moving room, or -1
+    std::array<int, 4> seats {-1, -1, -1, -1};
+    for (int p {0}; p < 4; p++) {
+        for (int i {0}; i < 4; i++) {
+            if (room_teams[p] == moving[i]) seats[p] = i;
+        }
+    }
+    return seats;
+}
+
+
+int best_candidate(const OrderLanes& losses, int size, Rng& rng) {
+    /*
+    Index of the lowest loss among the first size lanes, -1 if there
+    are none. Ties are settled by one draw from rng landing on one of
+    the tied lanes, which is as fair as shuffling the orders first.
+    (Scanning round from a random start is cheaper again, but favours
+    whichever tied order comes after a gap)
+    */
+    if (size == 0) return -1;
+    int min_loss {*std::min_element(losses.begin(), losses.begin() + size)};
+    int num_ties {0};
+    for (int k {0}; k < size; k++) num_ties += losses[k] == min_loss;
+    int nth = rng.below(num_ties);
+    for (int k {0}; k < size; k++) {
+        if (losses[k] == min_loss && nth-- == 0) return k;
+    }
+    return -1;
+}
+
+
+class OrderKernel {
+    /*
+    Scores all the candidate orders of one room together. Each layer is
+    one later round: the moving room's teams' scores going into it, the
+    later rooms they affect, and that round's histogram and pullup
+    counts. All the per-order work is fixed-length loops over the lanes
+    with no branches, which the compiler can vectorise, and nothing
+    about the search state is changed along the way.
+    Keeps its scratch space between calls, so it never allocates once
+    warmed up; one per worker
+    */
+public:
+    void start_layer(
+        const std::array<int, 4>& old_scores,
+        const std::array<int, 4>& base_scores,
+        const CandidateOrders& cands
+    ) {
+        // Moving team i goes from old_scores[i] to base_scores[i] + result
+        old_moved = old_scores;
+        for (int i {0}; i < 4; i++) {
+            for (int k {0}; k < num_orders; k++) {
+                new_moved[i][k] = base_scores[i] + cands.seat_scores[i][k];
+            }
+        }
+        rooms.clear();
+    }
+
+    void add_room(const RoomState& state, const std::array<int, 4>& seats) {
+        // seats as from seats_in_room, in the same order as state.scores
+        LaterRoom& room {rooms.emplace_back()};
+        for (int p {0}; p < 4; p++) {
+            if (seats[p] == -1) {
+                room.scores[p].fill(state.scores[p]);
+            } else {
+                room.scores[p] = new_moved[seats[p]];
+            }
+        }
+        room.old_pullups = state.pullups;
+        room.num_old_pullups = state.num_pullups;
+    }
+
+    void finish_layer(
+        const ScoreHistogram& usd,
+        const std::vector<int>& upd,
+        OrderLanes& losses
+    ) {
+        // Adds the layer's sandwich loss and pullup loss change to losses
+        window_lo = 1;
+        window_hi = 0;
+        if (rooms.empty()) return;
+        int lo {*std::min_element(old_moved.begin(), old_moved.end())};
+        int hi {*std::max_element(old_moved.begin(), old_moved.end())};
+        for (const LaterRoom& room : rooms) {
+            for (const OrderLanes& lane : room.scores) {
+                auto mm = std::minmax_element(lane.begin(), lane.end());
+                lo = std::min(lo, *mm.first);
+                hi = std::max(hi, *mm.second);
+            }
+        }
+        window_lo = lo;
+        window_hi = hi;
+        // Histogram prefix sums over just the scores that can come up
+        prefix.resize(hi + 2 - lo);
+        for (int s {lo}; s <= hi + 1; s++) prefix[s - lo] = usd.prefix_sum(s);
+        upd_delta.assign(hi + 1 - lo, OrderLanes {});
+
+        for (const LaterRoom& room : rooms) add_room_losses(room, lo, losses);
+
+        for (int s {lo}; s <= hi; s++) {
+            int before {upd[s]};
+            int excess_before {std::max(0, before - 3)};
+            const OrderLanes& delta {upd_delta[s - lo]};
+            for (int k {0}; k < num_orders; k++) {
+                losses[k] += std::max(0, before + delta[k] - 3) - excess_before;
+            }
+        }
+    }
+
+    // The scores the last finish_layer read usd and upd at (none if lo > hi)
+    int low() const { return window_lo; }
+    int high() const { return window_hi; }
+
+private:
+    class LaterRoom {
+    public:
+        std::array<OrderLanes, 4> scores {}; // Per team in the room
+        std::array<int, 3> old_pullups {};
+        int num_old_pullups {0};
+    };
+
+    std::array<int, 4> old_moved {};
+    std::array<OrderLanes, 4> new_moved {};
+    int window_lo {1};
+    int window_hi {0};
+    std::vector<LaterRoom> rooms {};
+    std::vector<int> prefix {}; // usd.prefix_sum(lo + i)
+    std::vector<OrderLanes> upd_delta {}; // Change to upd[lo + i], per order
+
+    void add_room_losses(const LaterRoom& room, int lo, OrderLanes& losses) {
+        OrderLanes min_val {room.scores[0]};
+        OrderLanes max_val {room.scores[0]};
+        for (int p {1}; p < 4; p++) {
+            for (int k {0}; k < num_orders; k++) {
+                min_val[k] = std::min(min_val[k], room.scores[p][k]);
+                max_val[k] = std::max(max_val[k], room.scores[p][k]);
+            }
+        }
+        for (int k {0}; k < num_orders; k++) {
+            // usd.sum_between, which can't go negative once min < max
+            int filling {
+                prefix[max_val[k] - lo] - prefix[min_val[k] + 1 - lo]
+            };
+            filling = std::max(0, filling);
+            // Correct usd for the moving teams, and drop intra-room ones
+            for (int i {0}; i < 4; i++) {
+                int moved {new_moved[i][k]};
+                filling += (min_val[k] < moved) & (moved < max_val[k]);
+                filling -= (min_val[k] < old_moved[i])
+                    & (old_moved[i] < max_val[k]);
+            }
+            for (int p {0}; p < 4; p++) {
+                int score {room.scores[p][k]};
+                filling -= (min_val[k] < score) & (score < max_val[k]);
+            }
+            losses[k] += filling;
+        }
+        // Swap the room's old pullups for the ones each order gives
+        for (int j {0}; j < room.num_old_pullups; j++) {
+            OrderLanes& delta {upd_delta[room.old_pullups[j] - lo]};
+            for (int k {0}; k < num_orders; k++) delta[k]--;
+        }
+        for (int p {0}; p < 4; p++) {
+            for (int k {0}; k < num_orders; k++) {
+                int score {room.scores[p][k]};
+                upd_delta[score - lo][k] += score < max_val[k];
+            }
+        }
+    }
+};
+
+#endif
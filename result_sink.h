@@ -0,0 +1,193 @@
+#ifndef RESULT_SINK_H
+#define RESULT_SINK_H
+
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <mutex>
+#include <cstdio>
+#include <stdexcept>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+
+
+class ResultSink {
+    /*
+    Where successful sims get written. The file is opened once and sim
+    numbers come from a counter, rather than re-reading the whole file
+    for every row. Each row goes out in a single write() on an O_APPEND
+    handle, so rows never interleave.
+    With shared=true the counter lives in <filename>.count instead of
+    memory, and both it and the file are only touched under flock, so
+    several processes can append to the same file safely.
+    With row_size > 0 rows are fixed-width binary records (see
+    sample_file.h), written as they come with no newline or sim number
+    */
+public:
+    ResultSink(
+        std::string fname, std::string hdr, bool shared_file=false,
+        int row_size=0
+    ) : filename {fname}, header {hdr}, shared {shared_file},
+        row_bytes {row_size} {
+        fd = open(filename.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+        if (fd < 0) throw std::runtime_error("Can't open " + filename);
+        if (shared) {
+            count_fd = open(
+                (filename + ".count").c_str(), O_RDWR | O_CREAT, 0644
+            );
+            if (count_fd < 0) {
+                throw std::runtime_error("Can't open " + filename + ".count");
+            }
+        } else {
+            next_sim = count_rows(); // Only time the file is ever re-read
+        }
+    }
+
+    ~ResultSink() {
+        if (fd >= 0) close(fd);
+        if (count_fd >= 0) close(count_fd);
+    }
+
+    ResultSink(const ResultSink&) = delete;
+    ResultSink& operator=(const ResultSink&) = delete;
+
+    bool is_binary() const { return row_bytes > 0; }
+    int get_row_bytes() const { return row_bytes; }
+    const std::string& get_header() const { return header; }
+
+    int write_row(const std::string& row) {
+        // Row is everything after the sim number, e.g. ",3,0,2"
+        return write_rows({row});
+    }
+
+    int write_rows(const std::vector<std::string>& rows) {
+        // Returns the sim number given to the first row
+        std::lock_guard<std::mutex> lock {mutex};
+        if (shared) flock(fd, LOCK_EX);
+        int first_sim {shared ? read_counter() : next_sim};
+        std::string out {};
+        struct stat file_stat {};
+        fstat(fd, &file_stat);
+        if (file_stat.st_size == 0) out += header;
+        int sim_num {first_sim};
+        for (const std::string& row : rows) {
+            if (is_binary()) {
+                out += row;
+                sim_num++;
+            } else {
+                out += "\n" + std::to_string(sim_num++) + row;
+            }
+        }
+        write_all(fd, out);
+        if (shared) {
+            write_counter(sim_num);
+            flock(fd, LOCK_UN);
+        } else {
+            next_sim = sim_num;
+        }
+        return first_sim;
+    }
+
+private:
+    std::string filename {};
+    std::string header {};
+    bool shared {false};
+    int row_bytes {0};
+    int fd {-1};
+    int count_fd {-1};
+    int next_sim {0};
+    std::mutex mutex {};
+
+    int count_rows() {
+        // Number of sims already in the file (lines minus the header)
+        if (is_binary()) {
+            struct stat file_stat {};
+            if (stat(filename.c_str(), &file_stat) != 0) return 0;
+            long body {(long)file_stat.st_size - (long)header.size()};
+            return std::max(0L, body / row_bytes);
+        }
+        std::ifstream check_file(filename);
+        int num_lines {0};
+        std::string line;
+        while (std::getline(check_file, line)) num_lines++;
+        return std::max(0, num_lines - 1);
+    }
+
+    int read_counter() {
+        // An empty counter means the file predates it, so count once
+        char buf[32] {};
+        ssize_t len {pread(count_fd, buf, sizeof(buf) - 1, 0)};
+        if (len <= 0) return count_rows();
+        return std::stoi(std::string(buf, len));
+    }
+
+    void write_counter(int value) {
+        std::string text {std::to_string(value)};
+        ftruncate(count_fd, 0);
+        pwrite(count_fd, text.c_str(), text.size(), 0);
+    }
+
+    static void write_all(int out_fd, const std::string& text) {
+        const char* pos {text.c_str()};
+        size_t left {text.size()};
+        while (left > 0) {
+            ssize_t done {::write(out_fd, pos, left)};
+            if (done < 0) throw std::runtime_error("Write to output failed");
+            pos += done;
+            left -= done;
+        }
+    }
+};
+
+
+std::string shard_filename(const std::string& filename, int shard) {
+    return filename + ".shard" + std::to_string(shard);
+}
+
+
+void merge_shards(ResultSink& sink, const std::string& filename, int shards) {
+    /*
+    Moves the rows of each per-worker shard file into the main sink,
+    renumbering them as it goes, then deletes the shard
+    */
+    for (int shard {0}; shard < shards; shard++) {
+        std::string shard_name {shard_filename(filename, shard)};
+        std::ifstream file(shard_name, std::ios::binary);
+        if (!file.is_open()) continue;
+        std::vector<std::string> rows;
+        if (sink.is_binary()) {
+            std::string row(sink.get_row_bytes(), '\0');
+            file.seekg(sink.get_header().size());
+            while (file.read(&row[0], row.size())) {
+                rows.push_back(row);
+                if (rows.size() == 10000) {
+                    sink.write_rows(rows);
+                    rows.clear();
+                }
+            }
+            file.close();
+            if (!rows.empty()) sink.write_rows(rows);
+            std::remove(shard_name.c_str());
+            continue;
+        }
+        std::string line;
+        std::getline(file, line); // Skip header
+        while (std::getline(file, line)) {
+            if (line.empty()) continue;
+            rows.push_back(line.substr(line.find(','))); // Drop old sim_num
+            if (rows.size() == 10000) { // Don't hold a whole shard in memory
+                sink.write_rows(rows);
+                rows.clear();
+            }
+        }
+        file.close();
+        if (!rows.empty()) sink.write_rows(rows);
+        std::remove(shard_name.c_str());
+    }
+}
+
+#endif
@@ -0,0 +1,80 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include <cstdint>
+#include <limits>
+#include <random>
+
+
+class Rng {
+    /*
+    xoshiro256**: four words of state and a few shifts per draw, so it is
+    cheap enough to call in the inner loop. seed(seed, stream) derives
+    the state from both numbers through splitmix64, so each run gets its
+    own stream off one --seed, and re-seeding with the same pair replays
+    the run exactly, whichever worker ends up doing it
+    */
+public:
+    using result_type = std::uint64_t;
+
+    Rng(std::uint64_t seed_value=0, std::uint64_t stream=0) {
+        seed(seed_value, stream);
+    }
+
+    void seed(std::uint64_t seed_value, std::uint64_t stream) {
+        std::uint64_t mix {stream};
+        mix = seed_value ^ splitmix64(mix);
+        for (std::uint64_t& word : state) word = splitmix64(mix);
+    }
+
+    std::uint64_t operator()() {
+        std::uint64_t result {rotl(state[1] * 5, 7) * 9};
+        std::uint64_t t {state[1] << 17};
+        state[2] ^= state[0];
+        state[3] ^= state[1];
+        state[1] ^= state[2];
+        state[0] ^= state[3];
+        state[2] ^= t;
+        state[3] = rotl(state[3], 45);
+        return result;
+    }
+
+    unsigned below(unsigned n) {
+        // Uniform in [0, n), from the top 32 bits by multiply and shift
+        return (unsigned)(((*this)() >> 32) * n >> 32);
+    }
+
+    double unit() {
+        // Uniform in [0, 1), from the top 53 bits
+        return ((*this)() >> 11) * 0x1.0p-53;
+    }
+
+    static constexpr std::uint64_t min() { return 0; }
+    static constexpr std::uint64_t max() {
+        return std::numeric_limits<std::uint64_t>::max();
+    }
+
+private:
+    std::uint64_t state[4] {};
+
+    static std::uint64_t rotl(std::uint64_t x, int k) {
+        return (x << k) | (x >> (64 - k));
+    }
+
+    static std::uint64_t splitmix64(std::uint64_t& x) {
+        // Steps x along, and returns a well mixed copy of it
+        std::uint64_t z {x += 0x9e3779b97f4a7c15};
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+        return z ^ (z >> 31);
+    }
+};
+
+
+std::uint64_t random_seed() {
+    // For when no --seed is given; printed so the runs can be replayed
+    std::random_device device {};
+    return (std::uint64_t)device() << 32 | device();
+}
+
+#endif
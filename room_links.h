@@ -0,0 +1,46 @@
+#ifndef ROOM_LINKS_H
+#define ROOM_LINKS_H
+
+#include <vector>
+#include <set>
+
+
+class RoomLinks {
+    /*
+    Links from each room to the later rooms its teams go on to, frozen
+    into compressed sparse row form once loading is done: the later rooms
+    of room i are indices[offsets[i]] up to indices[offsets[i + 1]].
+    Each room only has a handful, so walking them is a short run through
+    one array instead of hopping around a std::set
+    */
+public:
+    class Range {
+    public:
+        const int* first {nullptr};
+        const int* last {nullptr};
+
+        const int* begin() const { return first; }
+        const int* end() const { return last; }
+        int size() const { return (int)(last - first); }
+    };
+
+    std::vector<int> offsets {0};
+    std::vector<int> indices {};
+
+    RoomLinks() = default;
+    RoomLinks(const std::vector<std::set<int>>& links) {
+        for (const std::set<int>& room_links : links) {
+            indices.insert(indices.end(), room_links.begin(), room_links.end());
+            offsets.push_back((int)indices.size());
+        }
+    }
+
+    Range operator[](int room) const {
+        return {
+            indices.data() + offsets[room],
+            indices.data() + offsets[room + 1]
+        };
+    }
+};
+
+#endif
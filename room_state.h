@@ -0,0 +1,60 @@
+#ifndef ROOM_STATE_H
+#define ROOM_STATE_H
+
+#include <array>
+#include <algorithm>
+
+
+class alignas(32) RoomState {
+    /*
+    A worker's view of one room in a round whose draw depends on the
+    results being guessed: its teams' scores going into the round, and
+    which of those scores were pulled up. At most 3 teams can be pulled
+    up, so the whole thing sits inline in 32 bytes and updating it never
+    touches the allocator
+    */
+public:
+    std::array<int, 4> scores {};
+    std::array<int, 3> pullups {};
+    int num_pullups {0};
+
+    void set_scores(const std::array<int, 4>& new_scores) {
+        // Everyone below the top score in the room got pulled up
+        scores = new_scores;
+        int max_val {std::max(
+            std::max(scores[0], scores[1]), std::max(scores[2], scores[3])
+        )};
+        num_pullups = 0;
+        for (int score : scores) {
+            if (score < max_val) pullups[num_pullups++] = score;
+        }
+    }
+
+    int min_score() const {
+        return std::min(
+            std::min(scores[0], scores[1]), std::min(scores[2], scores[3])
+        );
+    }
+
+    int max_score() const {
+        return std::max(
+            std::max(scores[0], scores[1]), std::max(scores[2], scores[3])
+        );
+    }
+
+    class PullupRange {
+    public:
+        const int* first {nullptr};
+        const int* last {nullptr};
+
+        const int* begin() const { return first; }
+        const int* end() const { return last; }
+    };
+
+    PullupRange pullup_list() const {
+        // For range-for over just the pullups that are set
+        return {pullups.data(), pullups.data() + num_pullups};
+    }
+};
+
+#endif
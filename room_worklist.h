@@ -0,0 +1,74 @@
+#ifndef ROOM_WORKLIST_H
+#define ROOM_WORKLIST_H
+
+#include <vector>
+
+
+class RoomWorklist {
+    /*
+    The rooms worth another look, for a search that only revisits rooms
+    whose surroundings changed. Rooms are numbered across all the rounds
+    being guessed. Each is queued at most once at a time, and they come
+    off in the order they went on.
+    A room that was scored against scores lo to hi of some round watches
+    those buckets of that round's histograms, and touching a bucket
+    queues everyone watching it. Nothing else can change a room's
+    candidate losses, so a room that isn't queued would only pick the
+    same order again (or another tied one).
+    Keeps its storage from run to run, so it stops allocating once warm
+    */
+public:
+    void start(int rooms, int layers, int scores) {
+        // Empties the watch lists and queues every room, in order
+        num_scores = scores;
+        ring.assign(rooms, 0);
+        queued.assign(rooms, true);
+        for (int id {0}; id < rooms; id++) ring[id] = id;
+        head = 0;
+        count = rooms;
+        watchers.resize(layers * scores);
+        for (std::vector<int>& bucket : watchers) bucket.clear();
+    }
+
+    bool empty() const { return count == 0; }
+
+    int pop() {
+        int id {ring[head]};
+        head = (head + 1 == (int)ring.size()) ? 0 : head + 1;
+        count--;
+        queued[id] = false;
+        return id;
+    }
+
+    void push(int id) {
+        if (queued[id]) return;
+        queued[id] = true;
+        int tail {head + count};
+        if (tail >= (int)ring.size()) tail -= ring.size();
+        ring[tail] = id;
+        count++;
+    }
+
+    void watch(int layer, int lo, int hi, int id) {
+        for (int score {lo}; score <= hi; score++) {
+            watchers[layer * num_scores + score].push_back(id);
+        }
+    }
+
+    void touch(int layer, int score) {
+        // Stale entries only cost a spare visit, so no need to weed them
+        std::vector<int>& bucket {watchers[layer * num_scores + score]};
+        for (int id : bucket) push(id);
+        bucket.clear();
+    }
+
+private:
+    std::vector<int> ring {}; // Circular queue, room count long
+    std::vector<bool> queued {};
+    int head {0};
+    int count {0};
+    int num_scores {0};
+    std::vector<std::vector<int>> watchers {}; // [layer][score] -> room ids
+};
+
+#endif
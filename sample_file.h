@@ -0,0 +1,175 @@
+#ifndef SAMPLE_FILE_H
+#define SAMPLE_FILE_H
+
+#include <string>
+#include <string_view>
+#include <ostream>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include "csv_reader.h"
+
+
+class SampleHeader {
+    /*
+    The start of a binary sample file. Laid out as the magic string,
+    then (all little-endian) a uint32 team count, a uint32 round count,
+    a uint32 per round number covered, the uint64 seed, and each team
+    name as a uint32 length followed by its bytes, in team id order.
+    After that come the sims, one fixed-width row each and no sim
+    numbers: the result of team t in the i-th round covered is the 2
+    bits at bit 2 * (i * num_teams + t), counting from the low end of
+    each byte. So a sim for 800 teams over one round is 200 bytes
+    */
+public:
+    static constexpr std::string_view magic {"HTSAMP01"};
+
+    std::vector<std::string> names {};
+    std::vector<int> rounds {};
+    std::uint64_t seed {0};
+
+    int num_teams() const { return (int)names.size(); }
+
+    int row_bytes() const {
+        return ((int)rounds.size() * num_teams() * 2 + 7) / 8;
+    }
+
+    std::string encode() const {
+        std::string out {magic};
+        put(out, (std::uint32_t)names.size());
+        put(out, (std::uint32_t)rounds.size());
+        for (int round : rounds) put(out, (std::uint32_t)round);
+        put(out, seed);
+        for (const std::string& name : names) {
+            put(out, (std::uint32_t)name.size());
+            out += name;
+        }
+        return out;
+    }
+
+    static SampleHeader decode(std::string_view data, size_t& header_size) {
+        // header_size is set to where the rows start
+        SampleHeader header {};
+        size_t pos {0};
+        if (data.substr(0, magic.size()) != magic) {
+            throw std::runtime_error("not a sample file");
+        }
+        pos += magic.size();
+        std::uint32_t num_teams {get<std::uint32_t>(data, pos)};
+        std::uint32_t num_rounds {get<std::uint32_t>(data, pos)};
+        for (std::uint32_t i {0}; i < num_rounds; i++) {
+            header.rounds.push_back(get<std::uint32_t>(data, pos));
+        }
+        header.seed = get<std::uint64_t>(data, pos);
+        for (std::uint32_t i {0}; i < num_teams; i++) {
+            std::uint32_t len {get<std::uint32_t>(data, pos)};
+            if (pos + len > data.size()) {
+                throw std::runtime_error("sample header cut short");
+            }
+            header.names.emplace_back(data.substr(pos, len));
+            pos += len;
+        }
+        header_size = pos;
+        return header;
+    }
+
+    static bool is_sample_file(std::string_view data) {
+        return data.substr(0, magic.size()) == magic;
+    }
+
+private:
+    template<typename T>
+    static void put(std::string& out, T value) {
+        char bytes[sizeof(T)];
+        std::memcpy(bytes, &value, sizeof(T));
+        out.append(bytes, sizeof(T));
+    }
+
+    template<typename T>
+    static T get(std::string_view data, size_t& pos) {
+        if (pos + sizeof(T) > data.size()) {
+            throw std::runtime_error("sample header cut short");
+        }
+        T value {};
+        std::memcpy(&value, data.data() + pos, sizeof(T));
+        pos += sizeof(T);
+        return value;
+    }
+};
+
+
+void pack_result(std::string& row, int index, int result) {
+    // Sets result number index of a row that started out all zero
+    row[index / 4] |= (char)(result << (2 * (index % 4)));
+}
+
+
+int unpack_result(std::string_view row, int index) {
+    return ((unsigned char)row[index / 4] >> (2 * (index % 4))) & 3;
+}
+
+
+class SampleFile {
+    // A binary sample file, mapped and ready to hand out rows
+public:
+    SampleFile(const std::string& fname) : file {fname} {
+        std::string_view data {file.text()};
+        try {
+            header = SampleHeader::decode(data, rows_start);
+        } catch (const std::runtime_error& error) {
+            throw std::runtime_error(fname + ": " + error.what());
+        }
+        int row_bytes {header.row_bytes()};
+        if (row_bytes > 0) num_rows = (data.size() - rows_start) / row_bytes;
+    }
+
+    const SampleHeader& get_header() const { return header; }
+    int size() const { return num_rows; }
+
+    std::string_view row(int sim) const {
+        int row_bytes {header.row_bytes()};
+        size_t start {rows_start + (size_t)sim * row_bytes};
+        return file.text().substr(start, row_bytes);
+    }
+
+private:
+    MappedFile file;
+    SampleHeader header {};
+    size_t rows_start {0};
+    int num_rows {0};
+};
+
+
+void write_samples_csv(const SampleFile& samples, std::ostream& out) {
+    /*
+    The same CSV the backtabbers write without --binary: one column per
+    team if the file covers a single round, otherwise one per team per
+    round, named <team>_r<round>
+    */
+    const SampleHeader& header {samples.get_header()};
+    int num_teams {header.num_teams()};
+    int num_rounds {(int)header.rounds.size()};
+    out << "sim_num";
+    for (const std::string& name : header.names) {
+        if (num_rounds == 1) {
+            out << "," << name;
+            continue;
+        }
+        for (int round : header.rounds) out << "," << name << "_r" << round;
+    }
+    std::string line {};
+    for (int sim {0}; sim < samples.size(); sim++) {
+        std::string_view row {samples.row(sim)};
+        line = "\n" + std::to_string(sim);
+        for (int team {0}; team < num_teams; team++) {
+            for (int i {0}; i < num_rounds; i++) {
+                line += ',';
+                line += (char)('0' + unpack_result(row, i * num_teams + team));
+            }
+        }
+        out << line;
+    }
+}
+
+#endif
@@ -0,0 +1,124 @@
+#ifndef SAMPLE_QUEUE_H
+#define SAMPLE_QUEUE_H
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <cstddef>
+#include <cstdint>
+
+
+template <typename T>
+class SampleQueue {
+    /*
+    A bounded queue for handing sims from one stage to the next, with
+    any number of threads on either end. It follows Dmitry Vyukov's
+    bounded MPMC queue: a ring of cells, each with a sequence number
+    saying whose turn it is, so a push or pop only contends on one
+    counter and never takes a lock. push and pop yield while it's full
+    or empty; close() wakes everyone up, after which pushes fail and
+    pops drain what's left and then fail. Capacity is rounded up to a
+    power of two
+    */
+public:
+    SampleQueue(std::size_t capacity) {
+        std::size_t size {1};
+        while (size < capacity) size *= 2;
+        mask = size - 1;
+        cells.reset(new Cell[size]);
+        for (std::size_t i {0}; i < size; i++) cells[i].sequence = i;
+    }
+
+    SampleQueue(const SampleQueue&) = delete;
+    SampleQueue& operator=(const SampleQueue&) = delete;
+
+    bool try_push(T& value) {
+        // Moves value in, unless the queue is full
+        std::size_t pos {enqueue_pos.load(std::memory_order_relaxed)};
+        Cell* cell {};
+        while (true) {
+            cell = &cells[pos & mask];
+            std::size_t sequence {
+                cell->sequence.load(std::memory_order_acquire)
+            };
+            std::intptr_t diff {(std::intptr_t)sequence - (std::intptr_t)pos};
+            if (diff == 0) {
+                if (enqueue_pos.compare_exchange_weak(
+                        pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+        cell->value = std::move(value);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool try_pop(T& value) {
+        // Moves the oldest value out, unless the queue is empty
+        std::size_t pos {dequeue_pos.load(std::memory_order_relaxed)};
+        Cell* cell {};
+        while (true) {
+            cell = &cells[pos & mask];
+            std::size_t sequence {
+                cell->sequence.load(std::memory_order_acquire)
+            };
+            std::intptr_t diff {
+                (std::intptr_t)sequence - (std::intptr_t)(pos + 1)
+            };
+            if (diff == 0) {
+                if (dequeue_pos.compare_exchange_weak(
+                        pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = dequeue_pos.load(std::memory_order_relaxed);
+            }
+        }
+        value = std::move(cell->value);
+        cell->sequence.store(pos + mask + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool push(T& value) {
+        // Waits for room; false if the queue was closed first
+        while (!try_push(value)) {
+            if (closed) return false;
+            std::this_thread::yield();
+        }
+        return true;
+    }
+
+    bool pop(T& value) {
+        // Waits for a value; false once it's closed and empty
+        while (!try_pop(value)) {
+            if (closed) return try_pop(value);
+            std::this_thread::yield();
+        }
+        return true;
+    }
+
+    void close() { closed = true; }
+    bool is_closed() const { return closed; }
+
+private:
+    class Cell {
+    public:
+        std::atomic<std::size_t> sequence {0};
+        T value {};
+    };
+
+    std::unique_ptr<Cell[]> cells {};
+    std::size_t mask {0};
+    alignas(64) std::atomic<std::size_t> enqueue_pos {0};
+    alignas(64) std::atomic<std::size_t> dequeue_pos {0};
+    std::atomic<bool> closed {false};
+};
+
+#endif
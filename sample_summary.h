@@ -0,0 +1,164 @@
+#ifndef SAMPLE_SUMMARY_H
+#define SAMPLE_SUMMARY_H
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <fstream>
+#include <cstdio>
+#include <stdexcept>
+#include "csv_reader.h"
+
+
+class SampleSummary {
+    /*
+    Tallies sims as they succeed: how often each team got each result in
+    each round covered, and for a chosen few teams (e.g. those near the
+    break), how often each pair of them got each pair of results. The
+    tallies go out to a small CSV every flush_every sims and at the end,
+    so nobody has to re-read the sims to get the marginals, and runs that
+    only want those can skip writing sims altogether. With no filename
+    it only keeps the tallies in memory, for --bench.
+    The file has a row per team per round: team,round,sims,n0,n1,n2,n3,
+    where nR is how many of the sims gave the team R. With pair teams,
+    <filename>.pairs has team_a,team_b,round,sims,n00,n01,...,n33
+    */
+public:
+    SampleSummary(
+        std::string fname,
+        const std::vector<std::string>& team_names,
+        std::vector<int> round_nums,
+        std::vector<int> pair_team_ids={},
+        int flush_every_sims=100
+    ) : filename {fname}, names {team_names}, rounds {round_nums},
+        pair_teams {pair_team_ids}, flush_every {flush_every_sims} {
+        counts.assign(rounds.size() * names.size() * 4, 0);
+        pair_counts.assign(rounds.size() * num_pairs() * 16, 0);
+    }
+
+    void add_sim(const std::vector<const std::vector<int>*>& results) {
+        // One results vector per round covered, each indexed by team id
+        std::lock_guard<std::mutex> lock {mutex};
+        int num_teams {(int)names.size()};
+        for (int r {0}; r < (int)rounds.size(); r++) {
+            const std::vector<int>& round_results {*results[r]};
+            long long* round_counts {&counts[r * num_teams * 4]};
+            for (int team {0}; team < num_teams; team++) {
+                round_counts[team * 4 + round_results[team]]++;
+            }
+            long long* cell {&pair_counts[r * num_pairs() * 16]};
+            for (int i {0}; i < (int)pair_teams.size(); i++) {
+                int a {round_results[pair_teams[i]]};
+                for (int j {i + 1}; j < (int)pair_teams.size(); j++) {
+                    cell[a * 4 + round_results[pair_teams[j]]]++;
+                    cell += 16;
+                }
+            }
+        }
+        num_sims++;
+        if (num_sims % flush_every == 0) write_files();
+    }
+
+    void flush() {
+        std::lock_guard<std::mutex> lock {mutex};
+        write_files();
+    }
+
+    // Only safe to read once the workers are done
+    long long sims() const { return num_sims; }
+    const std::vector<int>& get_rounds() const { return rounds; }
+    long long count(int round_index, int team, int result) const {
+        return counts[(round_index * names.size() + team) * 4 + result];
+    }
+
+private:
+    std::string filename {};
+    std::vector<std::string> names {};
+    std::vector<int> rounds {};
+    std::vector<int> pair_teams {};
+    int flush_every {100};
+    long long num_sims {0};
+    std::vector<long long> counts {}; // [round][team][result]
+    std::vector<long long> pair_counts {}; // [round][pair][result, result]
+    std::mutex mutex {};
+
+    int num_pairs() const {
+        int num_pair_teams {(int)pair_teams.size()};
+        return num_pair_teams * (num_pair_teams - 1) / 2;
+    }
+
+    void write_files() {
+        if (filename.empty()) return;
+        int num_teams {(int)names.size()};
+        std::string sims {std::to_string(num_sims)};
+        std::string text {"team,round,sims,n0,n1,n2,n3"};
+        for (int team {0}; team < num_teams; team++) {
+            for (int r {0}; r < (int)rounds.size(); r++) {
+                text += "\n" + names[team] + "," + std::to_string(rounds[r]);
+                text += "," + sims;
+                for (int result {0}; result < 4; result++) {
+                    long long n {counts[(r * num_teams + team) * 4 + result]};
+                    text += "," + std::to_string(n);
+                }
+            }
+        }
+        replace_file(filename, text);
+        if (pair_teams.size() < 2) return;
+        text = "team_a,team_b,round,sims";
+        for (int a {0}; a < 4; a++) {
+            for (int b {0}; b < 4; b++) {
+                text += ",n" + std::to_string(a) + std::to_string(b);
+            }
+        }
+        for (int r {0}; r < (int)rounds.size(); r++) {
+            const long long* cell {&pair_counts[r * num_pairs() * 16]};
+            for (int i {0}; i < (int)pair_teams.size(); i++) {
+                for (int j {i + 1}; j < (int)pair_teams.size(); j++) {
+                    text += "\n" + names[pair_teams[i]];
+                    text += "," + names[pair_teams[j]];
+                    text += "," + std::to_string(rounds[r]) + "," + sims;
+                    for (int k {0}; k < 16; k++) {
+                        text += "," + std::to_string(cell[k]);
+                    }
+                    cell += 16;
+                }
+            }
+        }
+        replace_file(filename + ".pairs", text);
+    }
+
+    static void replace_file(
+        const std::string& fname, const std::string& text
+    ) {
+        // Write then rename, so a reader never sees half a summary
+        std::string tmp_name {fname + ".tmp"};
+        {
+            std::ofstream out(tmp_name, std::ios::trunc);
+            out << text << "\n";
+            if (!out) throw std::runtime_error("Can't write " + tmp_name);
+        }
+        if (std::rename(tmp_name.c_str(), fname.c_str()) != 0) {
+            throw std::runtime_error("Can't replace " + fname);
+        }
+    }
+};
+
+
+std::vector<int> read_team_list(
+    const std::string& fname, const TeamIndex& ids
+) {
+    // Team ids for the names in the first column of a file, one per line
+    MappedFile file {fname};
+    CsvReader reader {file};
+    std::vector<int> teams {};
+    while (reader.next_line()) {
+        int team {ids.find(reader[0])};
+        if (team == -1) {
+            throw reader.error("unknown team " + std::string(reader[0]));
+        }
+        teams.push_back(team);
+    }
+    return teams;
+}
+
+#endif
@@ -0,0 +1,22 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include "sample_file.h"
+
+
+int main(int argc, char* argv[]) {
+    // Turns a --binary output file back into the usual CSV
+    if (argc != 3) {
+        std::cerr << "usage: samples_to_csv <samples file> <csv file>\n";
+        return 1;
+    }
+    try {
+        SampleFile samples {argv[1]};
+        std::ofstream out(argv[2]);
+        write_samples_csv(samples, out);
+    } catch (const std::exception& error) {
+        std::cerr << error.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
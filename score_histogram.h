@@ -0,0 +1,52 @@
+#ifndef SCORE_HISTOGRAM_H
+#define SCORE_HISTOGRAM_H
+
+#include <vector>
+#include <algorithm>
+
+
+class ScoreHistogram {
+    /*
+    How many teams sit on each score, plus a Fenwick tree over those
+    counts, so the sum over a range of scores costs O(log n) rather than
+    a walk over every bucket in between. The number of scores is set at
+    construction, so it fits whatever points system the tournament uses
+    */
+public:
+    ScoreHistogram(int num_scores=0)
+        : counts(num_scores, 0), tree(num_scores + 1, 0) {};
+
+    int operator[](int score) const { return counts[score]; }
+    int size() const { return (int)counts.size(); }
+
+    void add(int score, int increment) {
+        counts[score] += increment;
+        for (int i {score + 1}; i < (int)tree.size(); i += i & -i) {
+            tree[i] += increment;
+        }
+    }
+
+    int prefix_sum(int score) const {
+        // Sum of the counts for every score below this one
+        int total {0};
+        for (int i {score}; i > 0; i -= i & -i) total += tree[i];
+        return total;
+    }
+
+    int sum_between(int low, int high) const {
+        // Sum of the counts for scores strictly between low and high
+        if (high - low < 2) return 0;
+        return prefix_sum(high) - prefix_sum(low + 1);
+    }
+
+    void clear() {
+        std::fill(counts.begin(), counts.end(), 0);
+        std::fill(tree.begin(), tree.end(), 0);
+    }
+
+private:
+    std::vector<int> counts {};
+    std::vector<int> tree {}; // 1-based Fenwick tree over counts
+};
+
+#endif
@@ -0,0 +1,175 @@
+#ifndef SEARCH_STRATEGY_H
+#define SEARCH_STRATEGY_H
+
+#include <string>
+#include <vector>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include "order_kernel.h"
+#include "rng.h"
+
+
+class StrategyOptions {
+public:
+    std::string name {"greedy"}; // greedy, anneal or tabu (--strategy S)
+    double temperature {1.0}; // Where anneal starts, or the hottest replica
+        // when tempering (--temperature T)
+    int tabu_tenure {0}; // Visits an undo stays tabu, 0 for a sweep's worth
+    int kicks {3}; // Perturb and carry on this often per run (--kicks N)
+    double kick_share {0.02}; // Rooms shaken up by a kick besides hot ones
+};
+
+
+class MoveChooser {
+    /*
+    Picks each room's next order out of its candidates' losses, one per
+    worker. greedy takes a lowest loss, settling ties at random, which is
+    plain coordinate descent. anneal draws order k with weight
+    exp(-(loss_k - lowest) / T), with T falling from the start
+    temperature to 0 over each descent, so early on it can climb out of
+    a basin and by the end it's greedy. tabu is greedy, except that a
+    room can't go back to the order it last left until tenure more
+    visits have passed, unless that would beat everything else (which
+    stops plateau moves undoing each other)
+    */
+public:
+    void start_run(const StrategyOptions& strategy_opts, int num_rooms) {
+        opts = strategy_opts;
+        anneal = opts.name == "anneal";
+        tabu = opts.name == "tabu";
+        tenure = (opts.tabu_tenure > 0) ? opts.tabu_tenure : num_rooms;
+        tabu_order.assign(num_rooms, -1);
+        tabu_until.assign(num_rooms, 0);
+        visits = 0;
+        set_progress(0);
+    }
+
+    void set_progress(double fraction) {
+        // How far through its budget the current descent is, 0 to 1
+        if (fixed) return;
+        temperature = (anneal) ? opts.temperature * (1 - fraction) : 0;
+        if (temperature < 0.05) temperature = 0; // Close enough to greedy
+    }
+
+    void fix_temperature(double new_temperature) {
+        // Holds the temperature here whatever the strategy, for tempering
+        fixed = true;
+        temperature = new_temperature;
+    }
+
+    double get_temperature() const { return temperature; }
+
+    long long get_visits() const { return visits; }
+
+    void advance(long long count) {
+        // Moves the clock past count visits chosen with choose_at
+        visits += count;
+    }
+
+    void absorb(
+        const MoveChooser& part, long long start, const std::vector<int>& rooms
+    ) {
+        /*
+        Takes back a copy that was handed rooms to choose for alongside
+        others: its tabu entries for those rooms, and the visits it made
+        after it was copied at visit start
+        */
+        for (int room : rooms) {
+            tabu_order[room] = part.tabu_order[room];
+            tabu_until[room] = part.tabu_until[room];
+        }
+        visits += part.visits - start;
+    }
+
+    int choose(
+        const OrderLanes& losses,
+        int size,
+        int room,
+        int current,
+        Rng& rng,
+        int& choosable
+    ) {
+        /*
+        Index of the chosen candidate, with choosable set to how many it
+        could have picked with a fair chance, so rooms with more than
+        one stay on the worklist. current is the candidate the room has
+        now, or -1
+        */
+        visits++;
+        return choose_at(losses, size, room, current, rng, choosable, visits);
+    }
+
+    int choose_at(
+        const OrderLanes& losses,
+        int size,
+        int room,
+        int current,
+        Rng& rng,
+        int& choosable,
+        long long visit
+    ) const {
+        /*
+        choose as if it were visit number visit, leaving the clock
+        alone, so threads can choose for rooms at once and the visits be
+        counted after
+        */
+        OrderLanes lanes {losses};
+        if (tabu && tabu_order[room] != -1 && visit < tabu_until[room]) {
+            int undo {tabu_order[room]};
+            int best_other {std::numeric_limits<int>::max()};
+            for (int k {0}; k < size; k++) {
+                if (k != undo) best_other = std::min(best_other, lanes[k]);
+            }
+            if (lanes[undo] >= best_other && undo != current) {
+                lanes[undo] = std::numeric_limits<int>::max();
+            }
+        }
+        int lowest {*std::min_element(lanes.begin(), lanes.begin() + size)};
+        choosable = 0;
+        if (temperature == 0) {
+            for (int k {0}; k < size; k++) choosable += lanes[k] == lowest;
+            return best_candidate(lanes, size, rng);
+        }
+        std::array<double, num_orders> weights {};
+        double total {0};
+        for (int k {0}; k < size; k++) {
+            double delta {(double)lanes[k] - lowest};
+            weights[k] = std::exp(-delta / temperature);
+            total += weights[k];
+            choosable += weights[k] > 0.01;
+        }
+        double pick {rng.unit() * total};
+        for (int k {0}; k < size; k++) {
+            pick -= weights[k];
+            if (pick < 0) return k;
+        }
+        return size - 1;
+    }
+
+    void note_move(int room, int left) {
+        // The room just left candidate left; tabu keeps it from going back
+        note_move_at(room, left, visits);
+    }
+
+    void note_move_at(int room, int left, long long visit) {
+        // note_move for a move chosen with choose_at
+        if (!tabu) return;
+        tabu_order[room] = left;
+        tabu_until[room] = visit + tenure;
+    }
+
+private:
+    StrategyOptions opts {};
+    bool anneal {false};
+    bool tabu {false};
+    bool fixed {false};
+    int tenure {0};
+    double temperature {0};
+    long long visits {0};
+    std::vector<int> tabu_order {}; // Per room, -1 for none
+    std::vector<long long> tabu_until {};
+};
+
+#endif
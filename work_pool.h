@@ -0,0 +1,87 @@
+#ifndef WORK_POOL_H
+#define WORK_POOL_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+
+class WorkPool {
+    /*
+    A handful of helper threads kept waiting for jobs, for splitting up
+    work too small to be worth starting threads for every time.
+    run(job) calls job(k) for every k below size(), k = 0 on the calling
+    thread, and returns once they have all finished. Helpers spin a
+    little before going to sleep, since jobs tend to come in quick
+    succession, and the caller spins (yielding) while it waits
+    */
+public:
+    WorkPool(int size) {
+        for (int k {1}; k < size; k++) {
+            helpers.emplace_back(&WorkPool::helper_loop, this, k);
+        }
+    }
+
+    ~WorkPool() {
+        {
+            std::lock_guard<std::mutex> lock {mutex};
+            stopping = true;
+            generation++;
+        }
+        wake.notify_all();
+        for (std::thread& helper : helpers) helper.join();
+    }
+
+    WorkPool(const WorkPool&) = delete;
+    WorkPool& operator=(const WorkPool&) = delete;
+
+    int size() const { return (int)helpers.size() + 1; }
+
+    void run(const std::function<void(int)>& job) {
+        if (helpers.empty()) {
+            job(0);
+            return;
+        }
+        current = &job;
+        pending = (int)helpers.size();
+        {
+            std::lock_guard<std::mutex> lock {mutex};
+            generation++;
+        }
+        wake.notify_all();
+        job(0);
+        while (pending > 0) std::this_thread::yield();
+        current = nullptr;
+    }
+
+private:
+    std::vector<std::thread> helpers {};
+    std::mutex mutex {};
+    std::condition_variable wake {};
+    const std::function<void(int)>* current {nullptr};
+    std::atomic<long long> generation {0};
+    std::atomic<int> pending {0};
+    bool stopping {false}; // Only touched under mutex
+
+    void helper_loop(int k) {
+        long long seen {0};
+        while (true) {
+            for (int spin {0}; spin < 2000 && generation == seen; spin++) {
+                std::this_thread::yield();
+            }
+            {
+                std::unique_lock<std::mutex> lock {mutex};
+                wake.wait(lock, [&] { return generation != seen; });
+                seen = generation;
+                if (stopping) return;
+            }
+            (*current)(k);
+            pending--;
+        }
+    }
+};
+
+#endif